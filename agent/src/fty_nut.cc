@@ -27,6 +27,7 @@
  */
 
 #include "fty_nut.h"
+#include "../lib/src/nut_inventory.h"
 #include "../lib/src/nut_mlm.h"
 
 /*
@@ -154,9 +155,22 @@ int main(int argc, char *argv []) {
     }
     // POLLING
     polling = zconfig_get(config, CONFIG_POLLING, "30");
+    const char* workers   = zconfig_get(config, CONFIG_POLLING_WORKERS, "1");
+    const char* deadbands = zconfig_get(config, CONFIG_DEADBANDS, "");
+    const char* status    = zconfig_get(config, CONFIG_STATUS_POLLING, "0");
+    const char* notify    = zconfig_get(config, CONFIG_NOTIFY, "");
+    const char* intervals = zconfig_get(config, CONFIG_DEVICE_POLLING, "");
+    const char* publish   = zconfig_get(config, CONFIG_PUBLISH, "0");
+    const char* minmax    = zconfig_get(config, CONFIG_PUBLISH_MIN_MAX, "false");
+    const char* digests   = zconfig_get(config, CONFIG_INVENTORY_DIGESTS, NUT_INVENTORY_DIGESTS);
 
     log_info("fty_nut - NUT (Network UPS Tools) wrapper/daemon");
 
+    // inventories which did not change while we were down are not sent again
+    if (*digests) {
+        NutDigests.open(digests);
+    }
+
     zactor_t *nut_server = zactor_new(fty_nut_server, MLM_ENDPOINT_VOID);
     if (!nut_server) {
         log_fatal("zactor_new (task = 'fty_nut_server', args = 'NULL') failed");
@@ -177,6 +191,13 @@ int main(int argc, char *argv []) {
 
     zstr_sendx(nut_server, ACTION_CONFIGURE, mapping_file.c_str(), NULL);
     zstr_sendx(nut_server, ACTION_POLLING, polling, NULL);
+    zstr_sendx(nut_server, ACTION_WORKERS, workers, NULL);
+    zstr_sendx(nut_server, ACTION_DEADBANDS, deadbands, NULL);
+    zstr_sendx(nut_server, ACTION_STATUS_POLLING, status, NULL);
+    zstr_sendx(nut_server, ACTION_NOTIFY, notify, NULL);
+    zstr_sendx(nut_server, ACTION_DEVICE_POLLING, intervals, NULL);
+    zstr_sendx(nut_server, ACTION_PUBLISH, publish, NULL);
+    zstr_sendx(nut_server, ACTION_PUBLISH_MIN_MAX, minmax, NULL);
 
     zstr_sendx(nut_device_alert, ACTION_POLLING, polling, NULL);
 
@@ -207,6 +228,20 @@ int main(int argc, char *argv []) {
             if (config) {
                 polling = zconfig_get(config, CONFIG_POLLING, "30");
                 zstr_sendx(nut_server, ACTION_POLLING, polling, NULL);
+                workers = zconfig_get(config, CONFIG_POLLING_WORKERS, "1");
+                zstr_sendx(nut_server, ACTION_WORKERS, workers, NULL);
+                deadbands = zconfig_get(config, CONFIG_DEADBANDS, "");
+                zstr_sendx(nut_server, ACTION_DEADBANDS, deadbands, NULL);
+                status = zconfig_get(config, CONFIG_STATUS_POLLING, "0");
+                zstr_sendx(nut_server, ACTION_STATUS_POLLING, status, NULL);
+                notify = zconfig_get(config, CONFIG_NOTIFY, "");
+                zstr_sendx(nut_server, ACTION_NOTIFY, notify, NULL);
+                intervals = zconfig_get(config, CONFIG_DEVICE_POLLING, "");
+                zstr_sendx(nut_server, ACTION_DEVICE_POLLING, intervals, NULL);
+                publish = zconfig_get(config, CONFIG_PUBLISH, "0");
+                zstr_sendx(nut_server, ACTION_PUBLISH, publish, NULL);
+                minmax = zconfig_get(config, CONFIG_PUBLISH_MIN_MAX, "false");
+                zstr_sendx(nut_server, ACTION_PUBLISH_MIN_MAX, minmax, NULL);
                 zstr_sendx(nut_device_alert, ACTION_POLLING, polling, NULL);
                 zstr_sendx(nut_sensor, ACTION_POLLING, polling, NULL);
             } else {
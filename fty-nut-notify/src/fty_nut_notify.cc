@@ -0,0 +1,85 @@
+/*  =========================================================================
+    fty_nut_notify - forwards upsmon notifications to fty-nut
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+/*
+@header
+    fty_nut_notify - NOTIFYCMD of upsmon, tells fty-nut to refresh a device
+@discuss
+    upsmon runs NOTIFYCMD with the message as argument and UPSNAME and
+    NOTIFYTYPE in the environment. The notification is pushed to the socket
+    fty-nut listens on (nut/notify_endpoint), fty-nut reads the device again
+    and publishes its values right away.
+
+    Without UPSNAME in the environment, the device and the type are taken
+    from the command line, e.g. fty-nut-notify ups@localhost ONBATT
+@end
+*/
+
+#include "../lib/src/nut_mlm.h"
+#include <czmq.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char* argv[])
+{
+    std::string endpoint = NUT_NOTIFY_ENDPOINT;
+    int         argn     = 1;
+
+    if (argn < argc && (streq(argv[argn], "--help") || streq(argv[argn], "-h"))) {
+        puts("fty-nut-notify [options] [UPSNAME NOTIFYTYPE] [message]");
+        puts("  --endpoint / -e        fty-nut notification endpoint (" NUT_NOTIFY_ENDPOINT ")");
+        puts("  --help / -h            this information");
+        return EXIT_SUCCESS;
+    }
+    if (argn + 1 < argc && (streq(argv[argn], "--endpoint") || streq(argv[argn], "-e"))) {
+        endpoint = argv[argn + 1];
+        argn += 2;
+    }
+
+    const char* upsName = getenv("UPSNAME");
+    const char* type    = getenv("NOTIFYTYPE");
+    if (!upsName || !type) {
+        if (argn + 1 >= argc) {
+            fprintf(stderr, "fty-nut-notify: UPSNAME and NOTIFYTYPE not set\n");
+            return EXIT_FAILURE;
+        }
+        upsName = argv[argn++];
+        type    = argv[argn++];
+    }
+    const char* message = argn < argc ? argv[argn] : "";
+
+    zsock_t* push = zsock_new_push(endpoint.c_str());
+    if (!push) {
+        fprintf(stderr, "fty-nut-notify: can't connect to %s\n", endpoint.c_str());
+        return EXIT_FAILURE;
+    }
+    // don't block upsmon when fty-nut is not running
+    zsock_set_sndtimeo(push, 1000);
+    zsock_set_linger(push, 1000);
+    int rv = zstr_sendx(push, upsName, type, message, NULL);
+    zsock_destroy(&push);
+    if (rv != 0) {
+        fprintf(stderr, "fty-nut-notify: can't send %s for %s to %s\n", type, upsName, endpoint.c_str());
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
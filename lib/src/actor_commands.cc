@@ -78,7 +78,111 @@ int actor_commands(mlm_client_t* /*client*/, zmsg_t** message_p, uint64_t& timeo
             timeout = 30000;
         }
         nut_agent.TTL(int(timeout * 2 / 1000));
+        nut_agent.polling(timeout);
         zstr_free(&polling);
+    } else if (streq(cmd, ACTION_STATUS_POLLING)) {
+        char* polling = zmsg_popstr(message);
+        if (!polling) {
+            log_error(
+                "Expected multipart string format: STATUS_POLLING/value. "
+                "Received STATUS_POLLING/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        char*  end;
+        double seconds = std::strtod(polling, &end);
+        if (end == polling || *end != '\0' || !(seconds >= 0)) {
+            log_error("invalid STATUS_POLLING value '%s', status lane disabled", polling);
+            seconds = 0;
+        }
+        nut_agent.statusPolling(uint64_t(seconds * 1000));
+        zstr_free(&polling);
+    } else if (streq(cmd, ACTION_NOTIFY)) {
+        char* endpoint = zmsg_popstr(message);
+        if (!endpoint) {
+            log_error(
+                "Expected multipart string format: NOTIFY/endpoint. "
+                "Received NOTIFY/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        // the socket itself is owned by the actor loop, see fty_nut_server
+        nut_agent.notifyEndpoint(endpoint);
+        zstr_free(&endpoint);
+    } else if (streq(cmd, ACTION_WORKERS)) {
+        char* workers = zmsg_popstr(message);
+        if (!workers) {
+            log_error(
+                "Expected multipart string format: WORKERS/value. "
+                "Received WORKERS/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        char*         end;
+        unsigned long count = std::strtoul(workers, &end, 10);
+        if (end == workers || *end != '\0' || count == 0 || count > NUT_MAX_POLLING_WORKERS) {
+            log_error("invalid WORKERS value '%s', using 1 instead", workers);
+            count = 1;
+        }
+        nut_agent.pollingWorkers(unsigned(count));
+        zstr_free(&workers);
+    } else if (streq(cmd, ACTION_DEADBANDS)) {
+        char* deadbands = zmsg_popstr(message);
+        if (!deadbands) {
+            log_error(
+                "Expected multipart string format: DEADBANDS/value. "
+                "Received DEADBANDS/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        nut_agent.deadbands(deadbands);
+        zstr_free(&deadbands);
+    } else if (streq(cmd, ACTION_DEVICE_POLLING)) {
+        char* intervals = zmsg_popstr(message);
+        if (!intervals) {
+            log_error(
+                "Expected multipart string format: DEVICE_POLLING/value. "
+                "Received DEVICE_POLLING/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        nut_agent.devicePolling(intervals);
+        zstr_free(&intervals);
+    } else if (streq(cmd, ACTION_PUBLISH)) {
+        char* publish = zmsg_popstr(message);
+        if (!publish) {
+            log_error(
+                "Expected multipart string format: PUBLISH/value. "
+                "Received PUBLISH/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        char*         end;
+        unsigned long seconds = std::strtoul(publish, &end, 10);
+        if (end == publish || *end != '\0') {
+            log_error("invalid PUBLISH value '%s', publishing every poll", publish);
+            seconds = 0;
+        }
+        nut_agent.publishInterval(uint64_t(seconds) * 1000);
+        zstr_free(&publish);
+    } else if (streq(cmd, ACTION_PUBLISH_MIN_MAX)) {
+        char* minmax = zmsg_popstr(message);
+        if (!minmax) {
+            log_error(
+                "Expected multipart string format: PUBLISH_MIN_MAX/value. "
+                "Received PUBLISH_MIN_MAX/nullptr");
+            zstr_free(&cmd);
+            zmsg_destroy(message_p);
+            return 0;
+        }
+        nut_agent.publishMinMax(streq(minmax, "true"));
+        zstr_free(&minmax);
     } else {
         log_warning("Command '%s' is unknown or not implemented", cmd);
     }
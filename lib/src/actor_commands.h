@@ -46,6 +46,34 @@ class NUTAgent;
 //      change polling interval, where
 //      value - new polling interval in seconds
 //
+//  STATUS_POLLING/value
+//      change interval of the status lane (ups.status, ups.alarm, ups.test.result only), where
+//      value - interval in seconds, may be fractional, 0 disables the lane
+//
+//  NOTIFY/endpoint
+//      listen for upsmon notifications (sent by fty-nut-notify) on endpoint,
+//      empty endpoint stops listening
+//
+//  WORKERS/value
+//      change number of threads reading NUT devices in parallel, where
+//      value - number of threads (each one has its own session to upsd)
+//
+//  DEADBANDS/value
+//      change thresholds of published measurements, where
+//      value - comma separated pattern=threshold[%], e.g. "voltage.*=1,realpower.*=2%"
+//
+//  DEVICE_POLLING/value
+//      polling intervals of device classes, where
+//      value - comma separated subtype=seconds, e.g. "ups=10,epdu=60,sts=30"
+//
+//  PUBLISH/value
+//      change publication interval, devices polled more often publish the mean of their samples, where
+//      value - interval in seconds, 0 publishes every poll
+//
+//  PUBLISH_MIN_MAX/value
+//      publish also min and max of the samples as quantity.min and quantity.max, where
+//      value - true or false
+//
 
 
 /// Performs the actor commands logic
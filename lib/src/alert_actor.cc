@@ -135,7 +135,11 @@ void alert_actor(zsock_t* pipe, void* args)
             last = now;
             log_debug("Polling data now");
             devices.updateDeviceList();
-            devices.updateFromNUT();
+            // NUT variables are read by fty_nut_server, see nut_snapshot.h
+            auto snapshot = NutSnapshots.get();
+            if (snapshot) {
+                devices.updateFromNUT(*snapshot);
+            }
             devices.publishRules(mb_client);
             devices.publishAlerts(client);
         }
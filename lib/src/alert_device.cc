@@ -20,6 +20,7 @@
 */
 
 #include "alert_device.h"
+#include "nut_key.h"
 #include <fty_common_macros.h>
 #include <fty_log.h>
 #include <fty_proto.h>
@@ -43,7 +44,7 @@ void Device::fixAlertLimits(DeviceAlert& alert)
     }
 }
 
-void Device::addAlert(const std::string& quantity, const std::map<std::string, std::vector<std::string>>& variables)
+void Device::addAlert(const std::string& quantity, const NutSnapshot::DeviceVars& variables)
 {
     log_debug("aa: device %s provides %s alert", assetName().c_str(), quantity.c_str());
     std::string prefix = daisychainPrefix() + quantity;
@@ -70,50 +71,30 @@ void Device::addAlert(const std::string& quantity, const std::map<std::string, s
     } // else go on using the freshly made "alert" instance
 
     // does the device evaluation?
-    {
-        const auto& it = variables.find(prefix + ".status");
-        if (it == variables.cend()) {
-            log_debug("aa: device %s doesn't support %s.status", assetName().c_str(), quantity.c_str());
-            return;
-        }
+    if (!variables.has(prefix, ".status")) {
+        log_debug("aa: device %s doesn't support %s.status", assetName().c_str(), quantity.c_str());
+        return;
     }
+    alert.statusId = NutNames.id(prefix, ".status");
 
     // some devices provides ambient.temperature.(high|low)
-    {
-        const auto& it = variables.find(prefix + ".high");
-        if (it != variables.cend()) {
-            alert.highWarning  = it->second[0];
-            alert.highCritical = it->second[0];
-        }
+    if (auto value = variables.get(prefix, ".high")) {
+        alert.highWarning  = std::string(*value);
+        alert.highCritical = std::string(*value);
     }
-    {
-        const auto& it = variables.find(prefix + ".low");
-        if (it != variables.cend()) {
-            alert.lowWarning  = it->second[0];
-            alert.lowCritical = it->second[0];
-        }
+    if (auto value = variables.get(prefix, ".low")) {
+        alert.lowWarning  = std::string(*value);
+        alert.lowCritical = std::string(*value);
     }
     // some devices provides ambient.temperature.(high|low).(warning|critical)
-    {
-        const auto& it = variables.find(prefix + ".high.warning");
-        if (it != variables.cend())
-            alert.highWarning = it->second[0];
-    }
-    {
-        const auto& it = variables.find(prefix + ".high.critical");
-        if (it != variables.cend())
-            alert.highCritical = it->second[0];
-    }
-    {
-        const auto& it = variables.find(prefix + ".low.warning");
-        if (it != variables.cend())
-            alert.lowWarning = it->second[0];
-    }
-    {
-        const auto& it = variables.find(prefix + ".low.critical");
-        if (it != variables.cend())
-            alert.lowCritical = it->second[0];
-    }
+    if (auto value = variables.get(prefix, ".high.warning"))
+        alert.highWarning = std::string(*value);
+    if (auto value = variables.get(prefix, ".high.critical"))
+        alert.highCritical = std::string(*value);
+    if (auto value = variables.get(prefix, ".low.warning"))
+        alert.lowWarning = std::string(*value);
+    if (auto value = variables.get(prefix, ".low.critical"))
+        alert.lowCritical = std::string(*value);
     // if some limits are missing, use those present
     fixAlertLimits(alert);
     if (alert.lowWarning.empty() || alert.lowCritical.empty() || alert.highWarning.empty() ||
@@ -148,88 +129,73 @@ std::map<std::string, DeviceAlert>& Device::alerts()
     return _alerts;
 }
 
-int Device::scanCapabilities(nut::TcpClient& conn)
+int Device::scanCapabilities(const NutSnapshot& snapshot)
 {
     log_debug("aa: scanning capabilities for %s", assetName().c_str());
-    if (!conn.isConnected())
-        return 0;
-    std::string prefix = daisychainPrefix();
-    int         retval = -1;
+    const std::string& prefix = daisychainPrefix();
+    int                retval = -1;
 
     for (auto& it : _alerts) {
         it.second.ruleRescanned = false;
     }
     try {
-        auto nutDevice = conn.getDevice(_nutName);
-        if (!nutDevice.isOk()) {
+        auto nutDevice = snapshot.device(_nutName);
+        if (!nutDevice) {
             throw std::runtime_error("device " + assetName() + " is not configured in NUT yet");
         }
-        auto vars = nutDevice.getVariableValues();
+        const auto& vars = *nutDevice;
         if (vars.empty())
             return 0;
 
         // Sensors handling
-        if (vars.find(prefix + "ambient.count") != vars.cend()) {
-            // New style sensor(s) (EMP002: ambient collection, with index)
-            auto sensor_count_var = vars.find(prefix + "ambient.count");
-            int  sensors_count    = std::stoi(sensor_count_var->second[0]);
+        int sensors_count = 0;
+        if (vars.has(prefix + "ambient.count")) {
+            // New style sensor(s) (EMP002: ambient collection, with index), see below
+            sensors_count = std::stoi(std::string(*vars.get(prefix + "ambient.count")));
             log_debug("aa: found %i sensor(s)", sensors_count);
-            for (int a = 1; a <= sensors_count; a++) {
-                std::string current_sensor = "ambient." + std::to_string(a) + ".temperature.status";
-                if (vars.find(prefix + current_sensor) != vars.cend()) {
-                    addAlert(current_sensor, vars);
-                    _scanned = true;
-                }
-                current_sensor = "ambient." + std::to_string(a) + ".humidity.status";
-                if (vars.find(prefix + current_sensor) != vars.cend()) {
-                    addAlert(current_sensor, vars);
-                    _scanned = true;
-                }
-            }
         } else {
             // Legacy sensor (EMP001: ambient collection, without index)
-            if (vars.find(prefix + "ambient.temperature.status") != vars.cend()) {
+            if (vars.has(prefix + "ambient.temperature.status")) {
                 addAlert("ambient.temperature", vars);
                 _scanned = true;
             }
-            if (vars.find(prefix + "ambient.humidity.status") != vars.cend()) {
+            if (vars.has(prefix + "ambient.humidity.status")) {
                 addAlert("ambient.humidity", vars);
                 _scanned = true;
             }
         }
 
-        // Input handling
-        for (int a = 1; a <= 3; a++) {
-            std::string q = "input.L" + std::to_string(a) + ".current";
-            if (vars.find(prefix + q + ".status") != vars.cend()) {
-                addAlert(q, vars);
-                _scanned = true;
+        // Indexed sensors, inputs and outlet groups, in one pass over the
+        // variables: their keys tell which is which (see NutKey)
+        static const NameId ambientTemperature = NutNames.id("ambient.#.temperature.status");
+        static const NameId ambientHumidity    = NutNames.id("ambient.#.humidity.status");
+        static const NameId inputCurrent       = NutNames.id("input.L#.current.status");
+        static const NameId inputVoltage       = NutNames.id("input.L#.voltage.status");
+        static const NameId groupCurrent       = NutNames.id("outlet.group.#.current.status");
+        static const NameId groupVoltage       = NutNames.id("outlet.group.#.voltage.status");
+        static const std::string_view status   = ".status";
+
+        vars.forEachId([&](NameId name, std::string_view) {
+            NutKey key = NutKeys.key(name);
+            if (key.collection == NutKey::Collection::None || key.device != uint32_t(chain())) {
+                return;
             }
-            q = "input.L" + std::to_string(a) + ".voltage";
-            if (vars.find(prefix + q + ".status") != vars.cend()) {
-                addAlert(q, vars);
-                _scanned = true;
-            }
-        }
-
-        // Outlets groups handling
-        for (int a = 1; a <= 1000; a++) {
-            int         found = 0;
-            std::string q     = "outlet.group." + std::to_string(a) + ".current";
-            if (vars.find(prefix + q + ".status") != vars.cend()) {
-                addAlert(q, vars);
-                ++found;
-                _scanned = true;
-            }
-            q = "outlet.group." + std::to_string(a) + ".voltage";
-            if (vars.find(prefix + q + ".status") != vars.cend()) {
-                addAlert(q, vars);
-                ++found;
-                _scanned = true;
+            std::string_view quantity = NutNames.name(name);
+            quantity.remove_prefix(prefix.size());
+            if (key.family == ambientTemperature || key.family == ambientHumidity) {
+                // the alert of a sensor is named with its .status
+                if (key.index > uint32_t(sensors_count)) {
+                    return;
+                }
+            } else if (((key.family == inputCurrent || key.family == inputVoltage) && key.index <= 3) ||
+                       key.family == groupCurrent || key.family == groupVoltage) {
+                quantity.remove_suffix(status.size());
+            } else {
+                return;
             }
-            if (!found)
-                break;
-        }
+            addAlert(std::string(quantity), vars);
+            _scanned = true;
+        });
     } catch (std::exception& e) {
         log_error("aa: Communication problem with %s (%s)", assetName().c_str(), e.what());
         retval = 0;
@@ -428,19 +394,21 @@ void Device::publishRule(mlm_client_t* client, DeviceAlert& alert)
     zmsg_destroy(&message);
 }
 
-void Device::update(nut::TcpClient& conn)
+void Device::update(const NutSnapshot& snapshot)
 {
-    auto nutDevice = conn.getDevice(_nutName);
-    if (!nutDevice.isOk())
+    auto nutDevice = snapshot.device(_nutName);
+    if (!nutDevice)
         return;
     for (auto& it : _alerts) {
         try {
-            std::string prefix = daisychainPrefix();
-            auto        value  = nutDevice.getVariableValue(prefix + it.first + ".status");
-            if (value.empty()) {
+            auto value = nutDevice->get(it.second.statusId);
+            if (!value) {
+                continue;
+            }
+            if (value->empty()) {
                 log_debug("aa: %s on %s is not present", it.first.c_str(), assetName().c_str());
             } else {
-                std::string newStatus = value[0];
+                std::string newStatus(*value);
                 log_debug("aa: %s on %s is %s", it.first.c_str(), assetName().c_str(), newStatus.c_str());
                 if (it.second.status != newStatus) {
                     it.second.timestamp = ::time(NULL);
@@ -452,9 +420,7 @@ void Device::update(nut::TcpClient& conn)
     }
 }
 
-std::string Device::daisychainPrefix() const
+const std::string& Device::daisychainPrefix() const
 {
-    if (chain() == 0)
-        return "";
-    return "device." + std::to_string(chain()) + ".";
+    return NutKeys.prefix(uint32_t(chain()));
 }
@@ -22,10 +22,10 @@
 #pragma once
 
 #include "asset_state.h"
+#include "nut_snapshot.h"
 #include <malamute.h>
 #include <map>
 #include <memory>
-#include <nutclient.h>
 #include <string>
 
 struct DeviceAlert
@@ -36,6 +36,7 @@ struct DeviceAlert
     std::string lowCritical;
     std::string highCritical;
     std::string status;
+    NameId      statusId      = 0; //!< interned NUT name of <quantity>.status
     int64_t     timestamp     = 0;
     bool        rulePublished = false;
     bool        ruleRescanned = false;
@@ -85,13 +86,13 @@ public:
         return _scanned;
     }
 
-    void update(nut::TcpClient& conn);
-    int  scanCapabilities(nut::TcpClient& conn);
+    void update(const NutSnapshot& snapshot);
+    int  scanCapabilities(const NutSnapshot& snapshot);
     void publishAlerts(mlm_client_t* client, uint64_t ttl);
     void publishRules(mlm_client_t* client);
 
 public:
-    void addAlert(const std::string& quantity, const std::map<std::string, std::vector<std::string>>& variables);
+    void addAlert(const std::string& quantity, const NutSnapshot::DeviceVars& variables);
     const std::map<std::string, DeviceAlert>& alerts() const;
     std::map<std::string, DeviceAlert>& alerts();
 
@@ -105,5 +106,5 @@ private:
     void        publishAlert(mlm_client_t* client, DeviceAlert& alert, uint64_t ttl);
     void        publishRule(mlm_client_t* client, DeviceAlert& alert);
     void        fixAlertLimits(DeviceAlert& alert);
-    std::string daisychainPrefix() const;
+    const std::string& daisychainPrefix() const;
 };
@@ -22,38 +22,34 @@
 #include <exception>
 #include <fty_log.h>
 #include <malamute.h>
-#include <nutclient.h>
 
 Devices::Devices(StateManager::Reader* reader)
     : _state_reader(reader)
 {
 }
 
-void Devices::updateFromNUT()
+void Devices::updateFromNUT(const NutSnapshot& snapshot)
 {
     try {
-        nut::TcpClient nutClient;
-        nutClient.connect("localhost", 3493);
-        updateDeviceCapabilities(nutClient);
-        updateDevices(nutClient);
-        nutClient.disconnect();
+        updateDeviceCapabilities(snapshot);
+        updateDevices(snapshot);
     } catch (std::exception& e) {
         log_error("reading data from NUT: %s", e.what());
     }
 }
 
-void Devices::updateDevices(nut::TcpClient& nutClient)
+void Devices::updateDevices(const NutSnapshot& snapshot)
 {
     for (auto& it : _devices) {
-        it.second.update(nutClient);
+        it.second.update(snapshot);
     }
 }
 
-void Devices::updateDeviceCapabilities(nut::TcpClient& nutClient)
+void Devices::updateDeviceCapabilities(const NutSnapshot& snapshot)
 {
     for (auto& it : _devices) {
         if (!it.second.scanned())
-            it.second.scanCapabilities(nutClient);
+            it.second.scanCapabilities(snapshot);
     }
 }
 
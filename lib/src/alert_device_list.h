@@ -27,7 +27,7 @@ class Devices
 {
 public:
     explicit Devices(StateManager::Reader* reader);
-    void updateFromNUT();
+    void updateFromNUT(const NutSnapshot& snapshot);
     void updateDeviceList();
     void publishAlerts(mlm_client_t* client);
     void publishRules(mlm_client_t* client);
@@ -43,7 +43,7 @@ private:
     std::map<std::string, Device>         _devices;
     std::unique_ptr<StateManager::Reader> _state_reader;
 
-    void updateDeviceCapabilities(nut::TcpClient& nutClient);
-    void updateDevices(nut::TcpClient& nutClient);
+    void updateDeviceCapabilities(const NutSnapshot& snapshot);
+    void updateDevices(const NutSnapshot& snapshot);
     void addIfNotPresent(const Device& dev);
 };
@@ -76,7 +76,7 @@ bool AssetState::handleAssetMessage(fty_proto_t* message)
     std::string operation(fty_proto_operation(message));
     if (operation == FTY_PROTO_ASSET_OP_DELETE || operation == FTY_PROTO_ASSET_OP_RETIRE ||
         !streq(fty_proto_aux_string(message, FTY_PROTO_ASSET_STATUS, "active"), "active")) {
-        return (powerdevices_.erase(name) > 0 || sensors_.erase(name) > 0);
+        return (erasePowerDevice(name) || sensors_.erase(name) > 0);
     }
 
     std::string type(fty_proto_aux_string(message, "type", ""));
@@ -104,7 +104,43 @@ bool AssetState::handleAssetMessage(fty_proto_t* message)
         log_error("unknown asset operation '%s'. Skipping.", operation.c_str());
         return false;
     }
-    (*map)[name] = std::shared_ptr<Asset>(new Asset(message));
+    if (map == &powerdevices_)
+        setPowerDevice(name, std::shared_ptr<Asset>(new Asset(message)));
+    else
+        map->insert_or_assign(name, std::shared_ptr<Asset>(new Asset(message)));
+    return true;
+}
+
+// Key of a daisy chain master in masters_, empty if the device is not one
+static std::string s_masterKey(const std::string& name, const AssetState::Asset& asset)
+{
+    if (asset.IP().empty() || asset.daisychain() > 1) {
+        return std::string();
+    }
+    return asset.IP() + '\0' + name;
+}
+
+void AssetState::setPowerDevice(const std::string& name, std::shared_ptr<Asset> asset)
+{
+    erasePowerDevice(name);
+    std::string key = s_masterKey(name, *asset);
+    if (!key.empty()) {
+        masters_.insert_or_assign(key, name);
+    }
+    powerdevices_.insert_or_assign(name, std::move(asset));
+}
+
+bool AssetState::erasePowerDevice(const std::string& name)
+{
+    auto it = powerdevices_.find(name);
+    if (it == powerdevices_.cend()) {
+        return false;
+    }
+    std::string key = s_masterKey(name, *it->second);
+    if (!key.empty()) {
+        masters_.erase(key);
+    }
+    powerdevices_.erase(name);
     return true;
 }
 
@@ -155,25 +191,12 @@ bool AssetState::updateFromMsg(zmsg_t* message)
 
 void AssetState::recompute()
 {
-    ip2master_.clear();
-    for (auto i : powerdevices_) {
-        const std::string& ip = i.second->IP();
-        if (ip == "") {
-            // this is strange. No IP?
-            continue;
-        }
-        if (i.second->daisychain() <= 1) {
-            // this is master
-            ip2master_[ip] = i.first;
-        }
-    }
-
     // Check if we can monitor
     allowed_powerdevices_.clear();
 
     if (m_allowMonitoring) {
-        AssetMap::const_iterator end = powerdevices_.end();
-        allowed_powerdevices_        = AssetMap(powerdevices_.cbegin(), end);
+        // shares the nodes of powerdevices_, nothing is copied
+        allowed_powerdevices_ = powerdevices_;
 
         log_info("Monitoring enable, %i devices will be monitored", allowed_powerdevices_.size());
     } else {
@@ -185,8 +208,12 @@ const std::string& AssetState::ip2master(const std::string& ip) const
 {
     static const std::string empty;
 
-    const auto i = ip2master_.find(ip);
-    if (i == ip2master_.cend())
-        return empty;
-    return i->second;
+    // the last master of the address in name order, as several ones may share it
+    const std::string  prefix = ip + '\0';
+    const std::string* master = &empty;
+    for (auto i = masters_.lower_bound(prefix); i != masters_.cend() && i->first.compare(0, prefix.size(), prefix) == 0;
+         ++i) {
+        master = &i->second;
+    }
+    return *master;
 }
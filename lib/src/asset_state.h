@@ -21,11 +21,11 @@
 
 #pragma once
 
+#include "persistent_map.h"
 #include <fty_proto.h>
 #include <map>
 #include <memory>
 #include <string>
-#include <unordered_map>
 
 class AssetState
 {
@@ -141,11 +141,12 @@ public:
     // Same for encoded proto messages or licensing messages which are not
     // proto. Note that this overload destroys the passed zmsg
     bool updateFromMsg(zmsg_t* message);
-    // Build the ip2master map and the list of allowed devices
+    // Build the list of allowed devices
     void recompute();
-    // Use a std::map to process the assets in a defined order each time
-    // Additions and removals do not happen _that_ often to worry about
-    typedef std::map<std::string, std::shared_ptr<Asset>> AssetMap;
+    // Ordered maps to process the assets in a defined order each time.
+    // Copies of the state share the nodes of their maps, so a commit only
+    // copies the paths to the assets which changed
+    typedef PersistentMap<std::string, std::shared_ptr<Asset>> AssetMap;
     // Return a map of power devices allowed by the current license
     const AssetMap& getPowerDevices() const
     {
@@ -174,11 +175,16 @@ public:
 private:
     bool     handleAssetMessage(fty_proto_t* message);
     bool     handleLicensingMessage(fty_proto_t* message);
+    // Update powerdevices_ and masters_ together
+    void     setPowerDevice(const std::string& name, std::shared_ptr<Asset> asset);
+    bool     erasePowerDevice(const std::string& name);
     AssetMap powerdevices_;
     // subset of powerdevices_ that are allowed by the license
-    AssetMap                                     allowed_powerdevices_;
-    AssetMap                                     sensors_;
-    std::unordered_map<std::string, std::string> ip2master_;
+    AssetMap allowed_powerdevices_;
+    AssetMap sensors_;
+    // "ip\0name" -> name of the power devices which are daisy chain masters,
+    // kept up to date with powerdevices_ instead of rebuilt at each commit
+    PersistentMap<std::string, std::string> masters_;
     // Active or not the monitoring
     bool m_allowMonitoring = true;
 };
@@ -23,11 +23,14 @@
 #include "actor_commands.h"
 #include "nut_agent.h"
 #include "nut_mlm.h"
+#include "nut_snapshot.h"
 #include "state_manager.h"
+#include <algorithm>
 #include <fty_common_mlm.h>
 #include <fty_log.h>
 
-StateManager NutStateManager;
+StateManager       NutStateManager;
+NutSnapshotManager NutSnapshots;
 
 static bool get_initial_licensing(StateManager::Writer& state_writer, mlm_client_t* client)
 {
@@ -147,20 +150,42 @@ void get_initial_assets(StateManager::Writer& state_writer, mlm_client_t* client
         state_writer.getState().getSensors().size(), state_writer.getState().getAllSensors().size());
 }
 
-uint64_t polling_timeout(uint64_t last_poll, uint64_t polling_timeout)
+// Complains when the devices are polled late again and again
+static void polling_late(const std::optional<uint64_t>& next_poll, uint64_t now, uint64_t polling_timeout)
 {
     static uint32_t too_short_poll_count = 0;
 
-    uint64_t now = static_cast<uint64_t>(zclock_mono());
-    if (last_poll + polling_timeout < now) {
+    if (next_poll && *next_poll + polling_timeout < now) {
         too_short_poll_count++;
         if (too_short_poll_count > 10) {
             log_error("Can't handle so many devices in so short polling interval");
         }
-        return 0;
+        return;
     }
     too_short_poll_count = 0;
-    return last_poll + polling_timeout - now;
+}
+
+// (Re)binds the socket receiving upsmon notifications when its endpoint has changed
+static void s_listen_notify(zpoller_t* poller, zsock_t*& notify, std::string& bound, const std::string& endpoint)
+{
+    if (endpoint == bound) {
+        return;
+    }
+    if (notify) {
+        zpoller_remove(poller, notify);
+        zsock_destroy(&notify);
+    }
+    bound = endpoint;
+    if (endpoint.empty()) {
+        return;
+    }
+    notify = zsock_new_pull(("@" + endpoint).c_str());
+    if (!notify) {
+        log_error("can't listen for NUT notifications on %s", endpoint.c_str());
+        return;
+    }
+    zpoller_add(poller, notify);
+    log_info("listening for NUT notifications on %s", endpoint.c_str());
 }
 
 void fty_nut_server(zsock_t* pipe, void* args)
@@ -220,27 +245,43 @@ void fty_nut_server(zsock_t* pipe, void* args)
     // will not receive any interfering stream messages
     get_initial_assets(state_writer, iclient, true);
 
-    uint64_t timestamp = static_cast<uint64_t>(zclock_mono());
-    uint64_t timeout   = 30000;
+    uint64_t timeout = 30000;
 
-    uint64_t last = uint64_t(zclock_mono());
+    zsock_t*    notify = nullptr; // upsmon notifications
+    std::string notifyEndpoint;
+
+    // Each NUT device has its own due time (see PollScheduler), the loop
+    // wakes up for the earliest one. Without devices, it still wakes up
+    // once per polling interval to pick up a new device list.
+    uint64_t lastList   = uint64_t(zclock_mono());
+    uint64_t lastStatus = lastList;
     while (!zsys_interrupted) {
-        void*    which = zpoller_wait(poller, int(polling_timeout(timestamp, timeout)));
+        uint64_t current = uint64_t(zclock_mono());
+        uint64_t next    = nut_agent.nextPoll().value_or(lastList + timeout);
+        if (nut_agent.statusPolling()) {
+            // wake up for the status lane in between
+            next = std::min(next, lastStatus + nut_agent.statusPolling());
+        }
+        void*    which = zpoller_wait(poller, int(next > current ? next - current : 0));
         uint64_t now   = uint64_t(zclock_mono());
-        if (now - last >= timeout) {
-            last = now;
-            log_debug("Periodic polling");
+        if (now >= next || now - lastList >= timeout) {
+            lastList = now;
             nut_agent.updateDeviceList();
-            nut_agent.onPoll();
+        }
+        // the earliest due time of the batch tells how late it is
+        auto due = nut_agent.nextPoll();
+        if (nut_agent.onPoll(now)) {
+            polling_late(due, now, timeout);
+        }
+        if (nut_agent.statusPolling() && now - lastStatus >= nut_agent.statusPolling()) {
+            lastStatus = now;
+            nut_agent.onStatusPoll();
         }
         if (which == NULL) {
             if (zpoller_terminated(poller) || zsys_interrupted) {
                 log_warning("zpoller_terminated () or zsys_interrupted");
                 break;
             }
-            if (zpoller_expired(poller)) {
-                timestamp = static_cast<uint64_t>(zclock_mono());
-            }
             continue;
         }
 
@@ -253,6 +294,12 @@ void fty_nut_server(zsock_t* pipe, void* args)
             if (actor_commands(client, &message, timeout, nut_agent) == 1) {
                 break;
             }
+            s_listen_notify(poller, notify, notifyEndpoint, nut_agent.notifyEndpoint());
+            continue;
+        }
+
+        if (notify && which == notify) {
+            nut_agent.onNotify(notify);
             continue;
         }
 
@@ -278,4 +325,9 @@ void fty_nut_server(zsock_t* pipe, void* args)
         zmsg_print(message);
         zmsg_destroy(&message);
     } // while (!zsys_interrupted)
+
+    if (notify) {
+        zpoller_remove(poller, notify);
+        zsock_destroy(&notify);
+    }
 }
@@ -0,0 +1,97 @@
+/*  =========================================================================
+    name_interner - process-wide table of NUT and 42ity variable names
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "name_interner.h"
+#include <mutex>
+#include <stdexcept>
+
+NameInterner NutNames;
+
+/// prefix + name in a per-thread buffer, which keeps its capacity
+static std::string_view s_concat(std::string_view prefix, std::string_view name)
+{
+    thread_local std::string buffer;
+    buffer.assign(prefix);
+    buffer.append(name);
+    return buffer;
+}
+
+NameInterner::NameInterner()
+{
+    // id 0 is the empty name
+    id(std::string_view());
+}
+
+NameId NameInterner::id(std::string_view name)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto                                it = _ids.find(name);
+        if (it != _ids.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    // somebody may have been faster
+    auto it = _ids.find(name);
+    if (it != _ids.end()) {
+        return it->second;
+    }
+    NameId id = NameId(_names.size());
+    _names.emplace_back(name);
+    _ids.emplace(_names.back(), id);
+    return id;
+}
+
+NameId NameInterner::id(std::string_view prefix, std::string_view name)
+{
+    return id(s_concat(prefix, name));
+}
+
+std::optional<NameId> NameInterner::find(std::string_view name) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    auto                                it = _ids.find(name);
+    if (it == _ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<NameId> NameInterner::find(std::string_view prefix, std::string_view name) const
+{
+    return find(s_concat(prefix, name));
+}
+
+const std::string& NameInterner::name(NameId id) const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    if (id >= _names.size()) {
+        throw std::out_of_range("unknown NameId " + std::to_string(id));
+    }
+    return _names[id];
+}
+
+size_t NameInterner::size() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    return _names.size();
+}
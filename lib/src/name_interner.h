@@ -0,0 +1,64 @@
+/*  =========================================================================
+    name_interner - process-wide table of NUT and 42ity variable names
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/// stable identifier of an interned name
+typedef uint32_t NameId;
+
+/// Maps each name ("output.L1.realpower", "realpower.output.L1", ...) to a
+/// stable NameId, so that the per-cycle lookups compare integers instead of
+/// building and comparing strings. Names are never removed, there are only a
+/// few thousands of them. Thread safe.
+class NameInterner
+{
+public:
+    NameInterner();
+
+    /// Returns id of the name, interns it if needed.
+    NameId id(std::string_view name);
+    /// Same as id(prefix + name), without allocating the concatenation.
+    NameId id(std::string_view prefix, std::string_view name);
+
+    /// Returns id of an already interned name, does not intern.
+    std::optional<NameId> find(std::string_view name) const;
+    std::optional<NameId> find(std::string_view prefix, std::string_view name) const;
+
+    /// Returns the name of an id. The reference stays valid forever.
+    const std::string& name(NameId id) const;
+
+    size_t size() const;
+
+private:
+    mutable std::shared_mutex                    _mutex;
+    std::deque<std::string>                      _names; //!< id -> name, elements never move
+    std::unordered_map<std::string_view, NameId> _ids;   //!< views of _names
+};
+
+extern NameInterner NutNames;
@@ -20,9 +20,13 @@
 */
 
 #include "nut_agent.h"
+#include "nut_inventory.h"
+#include "status_decoder.h"
 #include "ups_status.h"
 #include <fty_log.h>
 #include <fty_shm.h>
+#include <chrono>
+#include <cinttypes>
 //#include <cmath>
 #include <string>
 
@@ -43,26 +47,6 @@ const std::map<std::string, std::string> NUTAgent::_unitNameToSymbol =
 };
 // clang-format on
 
-// clang-format off
-const std::vector<std::string> alarmsList =
-{
-    "Replace battery!",
-    "Shutdown imminent!",
-    "Fan failure!",
-    "No battery installed!",
-    "Battery voltage too low!",
-    "Battery voltage too high!",
-    "Battery charger fail!",
-    "Temperature too high!",
-    "Internal UPS fault!",
-    "Awaiting power!",
-    "Automatic bypass mode!",
-    "Manual bypass mode!",
-    "Communication fault!",
-    "Fuse fault!"
-};
-// clang-format on
-
 NUTAgent::NUTAgent(StateManager::Reader* reader)
     : _state_reader(reader)
 {
@@ -82,6 +66,17 @@ bool NUTAgent::isMappingLoaded() const
     return _deviceList.mappingLoaded();
 }
 
+bool NUTAgent::deadbands(const std::string& rules)
+{
+    try {
+        _deviceList.setDeadbands(DeadbandRules::parse(rules));
+    } catch (const std::invalid_argument& e) {
+        log_error("invalid deadbands '%s': %s", rules.c_str(), e.what());
+        return false;
+    }
+    return true;
+}
+
 void NUTAgent::setClient(mlm_client_t* client)
 {
     if (!_client) {
@@ -95,26 +90,163 @@ void NUTAgent::setiClient(mlm_client_t* client)
     }
 }
 
-void NUTAgent::onPoll()
+bool NUTAgent::devicePolling(const std::string& rules)
+{
+    try {
+        _devicePolling = PollingIntervals::parse(rules);
+    } catch (const std::invalid_argument& e) {
+        log_error("invalid device polling intervals '%s': %s", rules.c_str(), e.what());
+        return false;
+    }
+    reschedule();
+    return true;
+}
+
+void NUTAgent::reschedule()
 {
+    // devices of one daisy chain are read together, at the shortest interval
+    std::map<std::string, uint64_t> intervals;
+    for (auto& device : _deviceList) {
+        uint64_t interval = _devicePolling.get(device.second.subtype(), _polling);
+        auto     it       = intervals.emplace(device.second.nutName(), interval).first;
+        it->second        = std::min(it->second, interval);
+    }
+    _scheduler.assign(intervals, uint64_t(zclock_mono()));
+
+    // forget the inventory and metrics of removed devices
+    for (auto it = _inventories.begin(); it != _inventories.end();) {
+        if (_deviceList.find(it->first) == _deviceList.end()) {
+            _shmBatch.forget(it->first);
+            // an asset created again gets its whole inventory
+            const std::string& topic = it->second.topic;
+            if (!topic.empty()) {
+                NutDigests.erase(std::string_view(topic).substr(topic.find('@') + 1));
+            }
+            it = _inventories.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for (auto it = _publications.begin(); it != _publications.end();) {
+        if (_deviceList.find(it->first) == _deviceList.end()) {
+            it = _publications.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool NUTAgent::onPoll(uint64_t now)
+{
+    auto due = _scheduler.due(now);
+    if (due.empty()) {
+        return false;
+    }
+    auto names = _deviceList.update(due, true);
+    _intervalDue += due.size();
+    _intervalUpdated += names.size();
+    _budget.add(PollBudget::Phase::Fetch, _deviceList.lastCost().fetchUs);
+    _budget.add(PollBudget::Phase::Transform, _deviceList.lastCost().transformUs);
+
+    auto start = std::chrono::steady_clock::now();
+    // share what has been read with alert_actor and sensor_actor
+    if (_deviceList.snapshot()) {
+        NutSnapshots.publish(_deviceList.snapshot());
+    }
     if (_client)
-        advertisePhysics();
-    if (_iclient)
-        advertiseInventory();
+        advertisePhysics(names);
+    if (_iclient && _budget.keepInventory(names.size()))
+        advertiseInventory(names);
+    _budget.add(PollBudget::Phase::Publish,
+        uint64_t(
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()));
+
+    // report once per window, with details while shedding
+    auto previous = _budget.level();
+    if (!_budget.endCycle(now, _polling)) {
+        return true;
+    }
+    log_info("Updated %zu devices of %zu NUT devices due in the last polling interval, busy %u%% of the time",
+        _intervalUpdated, _intervalDue, _budget.load());
+    _intervalDue     = 0;
+    _intervalUpdated = 0;
+    if (previous != PollBudget::None || _budget.level() != PollBudget::None) {
+        const auto& stats = _budget.stats();
+        log_warning(
+            "polling takes %u%% of the time (budget %u%%), shedding %s; "
+            "fetch %" PRIu64 " ms, transform %" PRIu64 " ms, publish %" PRIu64 " ms in %" PRIu64
+            " cycles, %" PRIu64 " overruns, %" PRIu64 " metrics and %" PRIu64 " inventories skipped",
+            _budget.load(), _budget.percent(), PollBudget::levelName(_budget.level()), stats.phaseUs[0] / 1000,
+            stats.phaseUs[1] / 1000, stats.phaseUs[2] / 1000, stats.cycles, stats.overruns, stats.skippedMetrics,
+            stats.skippedInventories);
+    }
+    return true;
+}
+
+void NUTAgent::onStatusPoll()
+{
+    if (!_client) {
+        return;
+    }
+    for (const auto& name : _deviceList.updateStatus()) {
+        auto& device = _deviceList[name];
+        beginBatch(device);
+        advertiseStatus(device.assetName(), device);
+        _shmBatch.commit();
+    }
+}
+
+std::string NUTAgent::onNotify(const std::string& upsName, const std::string& type)
+{
+    // upsmon sends ups@host
+    std::string nutName = upsName.substr(0, upsName.find('@'));
+    log_info("NUT notification %s for %s, refreshing it", type.c_str(), nutName.c_str());
+    if (!_client) {
+        return nutName;
+    }
+    auto names = _deviceList.update({nutName}, true);
+    if (names.empty()) {
+        log_warning("NUT device %s is not monitored or not reachable", nutName.c_str());
+        return nutName;
+    }
+    if (_deviceList.snapshot()) {
+        NutSnapshots.publish(_deviceList.snapshot());
+    }
+    // events do not wait for the next publication
+    advertisePhysics(names, true);
+    return nutName;
+}
+
+std::string NUTAgent::onNotify(zsock_t* notify)
+{
+    zmsg_t* message = zmsg_recv(notify);
+    if (!message) {
+        return std::string();
+    }
+    char*       ups  = zmsg_popstr(message);
+    char*       type = zmsg_popstr(message);
+    std::string nutName;
+    if (ups && type) {
+        nutName = onNotify(ups, type);
+    } else {
+        log_error("malformed NUT notification");
+    }
+    zstr_free(&ups);
+    zstr_free(&type);
+    zmsg_destroy(&message);
+    return nutName;
 }
 
 void NUTAgent::updateDeviceList()
 {
-    if (_state_reader->refresh())
+    if (_state_reader->refresh()) {
         _deviceList.updateDeviceList(_state_reader->getState());
+        reschedule();
+    }
 }
 
 int NUTAgent::send(const std::string& subject, zmsg_t** message_p)
 {
-    fty_proto_t* m_decoded = fty_proto_decode(message_p);
-    zmsg_destroy(message_p);
-    *message_p = fty_proto_encode(&m_decoded);
-
     int rv = mlm_client_send(_client, subject.c_str(), message_p);
     if (rv == -1) {
         log_error("mlm_client_send (subject = '%s') failed", subject.c_str());
@@ -123,13 +255,8 @@ int NUTAgent::send(const std::string& subject, zmsg_t** message_p)
     return rv;
 }
 
-// MVY: a hack for inventory messages
 int NUTAgent::isend(const std::string& subject, zmsg_t** message_p)
 {
-    fty_proto_t* m_decoded = fty_proto_decode(message_p);
-    zmsg_destroy(message_p);
-    *message_p = fty_proto_encode(&m_decoded);
-
     int rv = mlm_client_send(_iclient, subject.c_str(), message_p);
     if (rv == -1) {
         log_error("mlm_client_send (subject = '%s') failed", subject.c_str());
@@ -138,197 +265,275 @@ int NUTAgent::isend(const std::string& subject, zmsg_t** message_p)
     return rv;
 }
 
-std::string NUTAgent::physicalQuantityShortName(const std::string& longName) const
+uint64_t NUTAgent::interval(const drivers::nut::NUTDevice& device) const
 {
-    size_t i = longName.find('.');
-    if (i == std::string::npos) {
-        return longName;
+    uint64_t interval = _scheduler.interval(device.nutName());
+    return interval ? interval : _polling;
+}
+
+uint64_t NUTAgent::publication(const drivers::nut::NUTDevice& device) const
+{
+    return std::max(interval(device), _publishInterval);
+}
+
+int NUTAgent::ttl(const drivers::nut::NUTDevice& device) const
+{
+    // devices published less often than the global interval must not expire in between
+    return std::max(_ttl, int(publication(device) * 2 / 1000));
+}
+
+void NUTAgent::beginBatch(const drivers::nut::NUTDevice& device)
+{
+    // The ttl is kept as it is. An unchanged metric is rewritten once it
+    // would expire within the refresh margin (one publication interval and a
+    // half), that is by the last publication before it expires.
+    _shmBatch.begin(device.assetName(), ttl(device), uint64_t(zclock_mono()), publication(device) * 3 / 2);
+}
+
+void NUTAgent::advertisePhysics(const std::vector<std::string>& names, bool force)
+{
+    const uint64_t now = uint64_t(zclock_mono());
+    for (const auto& name : names) {
+        auto&    device   = _deviceList[name];
+        uint64_t sampling = interval(device);
+        if (_publishInterval <= sampling) {
+            advertiseDevice(device);
+            continue;
+        }
+        // sampled faster than published, the samples go to the aggregates
+        // until the publication is due (half a sample early is on time)
+        uint64_t& due = _publications[name];
+        if (!force && now + sampling / 2 < due) {
+            // status changes are not aggregated
+            beginBatch(device);
+            advertiseStatus(device.assetName(), device);
+            _shmBatch.commit();
+            continue;
+        }
+        due = now + _publishInterval;
+        advertiseDevice(device, true);
     }
-    return longName.substr(0, i);
 }
 
-std::string NUTAgent::physicalQuantityToUnits(const std::string& quantity) const
+const std::pair<NameId, NameId>& NUTAgent::companions(NameId quantity)
 {
-    auto it = _unitNameToSymbol.find(quantity);
-    if (it == _unitNameToSymbol.end()) {
-        return "";
+    auto it = _companions.find(quantity);
+    if (it == _companions.end()) {
+        const std::string& name = NutNames.name(quantity);
+        it = _companions.emplace(quantity, std::make_pair(NutNames.id(name, ".min"), NutNames.id(name, ".max"))).first;
     }
     return it->second;
 }
 
-void NUTAgent::advertisePhysics()
+void NUTAgent::advertiseDevice(drivers::nut::NUTDevice& device, bool aggregates)
 {
-    _deviceList.update(true);
-    for (auto& device : _deviceList) {
-        const std::string assetName{device.second.assetName()};
+    const std::string assetName{device.assetName()};
 
-        //map<str::quantity,str::value>
-        auto measurements = device.second.physics(false); // take NOT only changed
+    // take NOT only changed, walks the values in place
+    const auto& measurements = device.physicsValues();
 
 #if 0 // DBG, display <quantity, value> pairs owned by the asset
-        log_debug("### advertisePhysics, measurements for %s:", assetName.c_str());
-        for (const auto& measurement : measurements) {
-            log_debug("### \t%s: '%s'", measurement.first.c_str(), measurement.second.c_str());
-        }
+    log_debug("### advertisePhysics, measurements for %s:", assetName.c_str());
+    for (const auto& measurement : measurements) {
+        log_debug("### \t%s: '%s'", NutNames.name(measurement.name).c_str(), measurement.value.data());
+    }
 #endif
 
-        for (const auto& measurement : measurements) {
-            const std::string quantity{measurement.first}; // or property
-            const std::string value{measurement.second};
-            std::string type{physicalQuantityShortName(quantity)};
-            std::string units{physicalQuantityToUnits(type)};
-
-            int r = fty::shm::write_metric(assetName, quantity, value, units, _ttl);
-            if (r != 0)
-                log_error("failed to send measurement %s@%s", quantity.c_str(), assetName.c_str());
-            device.second.setChanged(quantity, false);
+    // all metrics of the device go in one batch, committed at the end
+    beginBatch(device);
+    for (const auto& measurement : measurements) {
+        const std::string& quantity = NutNames.name(measurement.name); // or property
+        if (!_budget.keepMetric(quantity)) {
+            continue;
         }
-
-        // 'load' computing
-        // BIOS-1185 start
-        // if it is epdu, that doesn't provide load.default,
-        // but it is still could be calculated (because input.current is known) then do this
-        if (device.second.subtype() == "epdu" && measurements.count("load.default") == 0) {
-            if (measurements.count("load.input.L1") != 0) {
-                std::string value = measurements.at("load.input.L1");
-                int r = fty::shm::write_metric(assetName, "load.default", value, "%", _ttl);
-                if (r != 0)
-                    log_error("failed to write load.default@%s, result %i", assetName.c_str(), r);
-            }
-            else if (measurements.count("current.input.L1") != 0) { // it is a mapped value!!!!!!!!!!!
-                // try to compute it
-                // 1. Determine the MAX value
-                double max_value = std::nan("");
-                if (measurements.count("current.input.nominal") == 1) {
-                    try {
-                        max_value = std::stod(measurements.at("current.input.nominal"));
-                        log_debug("load.default: max_value %lf from UPS", max_value);
-                    }
-                    catch (...) {
-                    }
-                }
-                else {
-                    max_value = device.second.maxCurrent();
-                    log_debug("load.default: max_value %lf from user", max_value);
-                }
-                // 2. if MAX value is known -> do work, otherwise skip
-                if (!std::isnan(max_value)) {
-                    double value = 0;
-                    try {
-                        value = std::stod(measurements.at("current.input.L1"));
-                    } catch (...) {
-                    };
-                    char buffer[50];
-                    // 3. compute a real value
-                    sprintf(buffer, "%lf", value * 100 / max_value); // because it is %!!!!
-                    // 4. form message
-                    // 5. send the messsage
-                    int r = fty::shm::write_metric(assetName, "load.default", buffer, "%", _ttl);
-                    if (r != 0)
-                        log_error("failed to write load.default@%s, result %i", assetName.c_str(), r);
-                }
-            }
+        const auto* aggregate = aggregates ? measurements.aggregate(measurement.name) : nullptr;
+        if (!aggregate) {
+            _shmBatch.add(measurement.name, measurement.value);
+            continue;
         }
-
-        // send alarms as bitmap
-        bool has_alarms = false;
-        if (device.second.hasProperty("ups.alarm")) {
-            const auto& alarms               = device.second.property("ups.alarm");
-            int         bitfield             = 0;
-            int         bit                  = 0;
-            int         internal_failure_bit = 0;
-            for (const auto& i : alarmsList) {
-                if (alarms.find(i) != std::string::npos) {
-                    bitfield |= (1 << bit);
-                    has_alarms = true;
+        char buffer[FixedPoint::MAX_TEXT];
+        _shmBatch.add(measurement.name, std::string_view(buffer, aggregate->mean().format(buffer)));
+        if (_publishMinMax) {
+            const auto& names = companions(measurement.name);
+            _shmBatch.add(names.first, std::string_view(buffer, aggregate->min.format(buffer)));
+            _shmBatch.add(names.second, std::string_view(buffer, aggregate->max.format(buffer)));
+        }
+    }
+    device.setPhysicsChanged(false);
+    device.resetAggregates();
+
+    static const NameId loadDefault = NutNames.id("load.default");
+
+    auto measurement = [&measurements](const char* quantity) {
+        return measurements.get(NutNames.find(quantity));
+    };
+
+    // 'load' computing
+    // BIOS-1185 start
+    // if it is epdu, that doesn't provide load.default,
+    // but it is still could be calculated (because input.current is known) then do this
+    if (device.subtype() == "epdu" && !measurement("load.default") && _budget.keepMetric("load.default")) {
+        if (auto load = measurement("load.input.L1")) {
+            _shmBatch.add(loadDefault, *load, "%");
+        }
+        else if (auto current = measurement("current.input.L1")) { // it is a mapped value!!!!!!!!!!!
+            // try to compute it
+            // 1. Determine the MAX value
+            double max_value = std::nan("");
+            if (auto nominal = measurement("current.input.nominal")) {
+                try {
+                    max_value = std::stod(std::string(*nominal));
+                    log_debug("load.default: max_value %lf from UPS", max_value);
                 }
-                if (i == "Internal UPS fault!") {
-                    internal_failure_bit = bit;
+                catch (...) {
                 }
-                bit++;
             }
-            // TODO FIXME I hate this kind of fix, but it was to be quick and dirty
-            if (alarms.find("Internal failure!") != std::string::npos) {
-                bitfield |= (1 << internal_failure_bit);
+            else {
+                max_value = device.maxCurrent();
+                log_debug("load.default: max_value %lf from user", max_value);
             }
-            int r = fty::shm::write_metric(assetName, "ups.alarm", std::to_string(bitfield), "", _ttl);
-            if (r != 0)
-                log_error("failed to write ups.alarm@%s, result %i", assetName.c_str(), r);
-
-            device.second.setChanged("ups.alarm", false);
-        }
-
-        // send status and "in progress" test result as a bitmap
-        if (device.second.hasProperty("status.ups")) {
-            std::string status_s = device.second.property("status.ups");
-            if (!status_s.empty()) { // fix IPMVAL-1889 (empty on data-stale)
-                std::string test_s =
-                    (device.second.hasProperty("ups.test.result") ? device.second.property("ups.test.result")
-                                                                  : "no test initiated");
-                uint16_t status_i = upsstatus_to_int(status_s, test_s);
-                if (has_alarms) {
-                    status_i |= STATUS_ALARM;
-                }
-                // hotfix IPMVAL-1889 (status.ups and data-stale) > increase ttl from 60 to 90 sec.
-                // _ttl is 60
-                //    - see cfg file "nut/polling_interval = 30"
-                //    - see ttl computation (2*polling_interval) in actor_commands.cc cmd=ACTION_POLLING
-                // here we increase _ttl of 50%, to pass metric ttl to 90
-                int r = fty::shm::write_metric(assetName, "status.ups", std::to_string(status_i), " ", _ttl * 3 / 2);
-                if (r != 0)
-                    log_error("failed to write status.ups@%s, result %i", assetName.c_str(), r);
-
-                // publish power.status (same ttl policy)
-                r = fty::shm::write_metric(assetName, "power.status", power_status(status_i), " ", _ttl * 3 / 2);
-                if (r != 0)
-                    log_error("failed to write power.status@%s, result %i", assetName.c_str(), r);
-
-                device.second.setChanged("status.ups", false);
+            // 2. if MAX value is known -> do work, otherwise skip
+            if (!std::isnan(max_value)) {
+                double value = 0;
+                try {
+                    value = std::stod(std::string(*current));
+                } catch (...) {
+                };
+                char buffer[50];
+                // 3. compute a real value
+                sprintf(buffer, "%lf", value * 100 / max_value); // because it is %!!!!
+                // 4. form message
+                // 5. send the messsage
+                _shmBatch.add(loadDefault, buffer, "%");
             }
         }
+    }
 
-        // send epdu outlet status as bitmap
-        for (int i = 1; i < 100; i++) {
-            std::string property = "status.outlet." + std::to_string(i);
-            // assumption, if outlet.10 does not exists, outlet.11 does not as well
-            if (!device.second.hasProperty(property))
-                break;
-            std::string status_s = device.second.property(property);
-            uint16_t    status_i = status_s == "on" ? 42 : 0;
+    advertiseStatus(assetName, device);
 
-            int r = fty::shm::write_metric(assetName, property, std::to_string(status_i), " ", _ttl);
-            if (r != 0)
-                log_error("failed to write %s@%s, result %i", property.c_str(), assetName.c_str(), r);
+    // send epdu outlet status as bitmap
+    static const NameId outletStatus = NutNames.id("status.outlet.#");
+    for (NameId property : device.family(outletStatus)) {
+        if (!_budget.keepMetric(NutNames.name(property)))
+            continue;
+        auto status_s = device.inventoryValues().get(property);
+        _shmBatch.add(property, status_s == std::string_view("on") ? "42" : "0", " ");
 
-            device.second.setChanged(property, false);
-        }
+        device.setChanged(property, false);
     }
+
+    // failures are logged by the batch
+    _shmBatch.commit();
 }
 
-void NUTAgent::advertiseInventory()
+void NUTAgent::advertiseStatus(const std::string& /*assetName*/, drivers::nut::NUTDevice& device)
 {
-    bool advertiseAll = false;
-    if (_inventoryTimestamp_ms + NUT_INVENTORY_REPEAT_AFTER_MS < static_cast<uint64_t>(zclock_mono())) {
-        advertiseAll           = true;
-        _inventoryTimestamp_ms = static_cast<uint64_t>(zclock_mono());
+    static const NameId upsAlarm    = NutNames.id("ups.alarm");
+    static const NameId statusUps   = NutNames.id("status.ups");
+    static const NameId powerStatus = NutNames.id("power.status");
+    static const NameId testResult  = NutNames.id("ups.test.result");
+
+    const int   ttl       = this->ttl(device);
+    const auto& inventory = device.inventoryValues();
+
+    // send alarms as bitmap
+    bool has_alarms = false;
+    if (auto alarms = inventory.get(upsAlarm)) {
+        UpsAlarms decoded = decodeUpsAlarms(*alarms);
+        has_alarms        = decoded.listed;
+        _shmBatch.add(upsAlarm, std::to_string(decoded.bits), "");
+
+        device.setChanged(upsAlarm, false);
     }
 
-    for (auto& device : _deviceList) {
-        const std::string assetName{device.second.assetName()};
+    // send status and "in progress" test result as a bitmap
+    if (auto status_s = inventory.get(statusUps)) {
+        if (!status_s->empty()) { // fix IPMVAL-1889 (empty on data-stale)
+            uint16_t status_i = decodeUpsStatus(*status_s, inventory.get(testResult).value_or("no test initiated"));
+            if (has_alarms) {
+                status_i |= STATUS_ALARM;
+            }
+            // hotfix IPMVAL-1889 (status.ups and data-stale) > increase ttl from 60 to 90 sec.
+            // ttl is _ttl (60), unless the device is published less often than that allows
+            //    - see cfg file "nut/polling_interval = 30"
+            //    - see ttl computation (2*polling_interval) in actor_commands.cc cmd=ACTION_POLLING
+            // here we increase ttl of 50%, to pass metric ttl to 90
+            _shmBatch.add(statusUps, std::to_string(status_i), " ", ttl * 3 / 2);
 
+            // publish power.status (same ttl policy)
+            _shmBatch.add(powerStatus, power_status(status_i), " ", ttl * 3 / 2);
+
+            device.setChanged(statusUps, false);
+        }
+    }
+}
+
+void NUTAgent::advertiseInventory(const std::vector<std::string>& names)
+{
+    static const NameId statusUps = NutNames.id("status.ups");
+
+    for (const auto& deviceName : names) {
+        auto&             device = _deviceList[deviceName];
+        const std::string assetName{device.assetName()};
+
+        // whole inventory is repeated once in a while, each device at its
+        // own time of the period, not the whole fleet at once
+        uint64_t   now          = static_cast<uint64_t>(zclock_time());
+        Inventory& state        = _inventories[deviceName];
+        bool       advertiseAll = inventoryDue(assetName, state.timestamp, now, NUT_INVENTORY_REPEAT_AFTER_MS);
+        // status.ups is published as a metric, its flag does not count here
+        const auto& values  = device.inventoryValues();
+        bool        changed = values.changedCount() > (values.changed(statusUps) ? 1u : 0u);
+        if (!advertiseAll && !changed) {
+            continue;
+        }
+
+        // the digest of what was last published survives restarts, an
+        // inventory which is still the same is not sent again
+        InventoryDigest digest;
+        for (const auto& item : device.inventoryValues()) {
+            if (item.name != statusUps) {
+                digest.add(NutNames.name(item.name), item.value);
+            }
+        }
+        if (NutDigests.get(assetName) == digest.value() && (!advertiseAll || state.timestamp == 0)) {
+            if (state.timestamp == 0) {
+                state.timestamp = now;
+            }
+            for (const auto& item : device.inventoryValues()) {
+                if (item.name != statusUps) {
+                    device.setChanged(item.name, false);
+                }
+            }
+            continue;
+        }
+        if (advertiseAll) {
+            state.timestamp = now;
+        }
+        // built on first use and if the NUT device got another asset
+        if (std::string_view(state.topic).substr(state.topic.find('@') + 1) != assetName) {
+            state.topic = inventoryTopic(assetName);
+        }
+
+        // not autofree, values stay in the store until the message is encoded
         zhash_t* inventory = zhash_new();
-        zhash_autofree(inventory);
 
         // !advertiseAll = advertise_Not_OnlyChanged
         std::string log; //dbg
-        for (auto& item : device.second.inventory(!advertiseAll)) {
-            if (item.first == "status.ups") {
+        for (const auto& item : device.inventoryValues()) {
+            if (!advertiseAll && !item.changed) {
+                continue;
+            }
+            if (item.name == statusUps) {
                 // this value is not advertised as inventory information
                 continue;
             }
-            zhash_insert(inventory, item.first.c_str(), const_cast<char*>(item.second.c_str()));
-            log += item.first + " = \"" + item.second + "\"; ";
-            device.second.setChanged(item.first, false);
+            const std::string& name = NutNames.name(item.name);
+            // values of the store are NUL terminated
+            zhash_insert(inventory, name.c_str(), const_cast<char*>(item.value.data()));
+            log += name + " = \"" + std::string(item.value) + "\"; ";
+            // only flips a bit, iteration goes on
+            device.setChanged(item.name, false);
         }
 
         if (zhash_size(inventory) == 0) {
@@ -336,16 +541,16 @@ void NUTAgent::advertiseInventory()
             continue;
         }
 
-        zmsg_t* message = fty_proto_encode_asset(NULL, assetName.c_str(), "inventory", inventory);
+        zmsg_t* message = encodeInventory(assetName, &inventory);
 
         if (message) {
-            std::string topic = "inventory@" + assetName;
-            log_debug("new inventory message '%s': %s", topic.c_str(), log.c_str());
-            int r = isend(topic, &message);
+            log_debug("new inventory message '%s': %s", state.topic.c_str(), log.c_str());
+            int r = isend(state.topic, &message);
             if (r != 0)
-                log_error("failed to send inventory %s result %i", topic.c_str(), r);
+                log_error("failed to send inventory %s result %i", state.topic.c_str(), r);
+            else
+                NutDigests.set(assetName, digest.value());
             zmsg_destroy(&message);
         }
-        zhash_destroy(&inventory);
     }
 }
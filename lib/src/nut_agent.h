@@ -21,10 +21,17 @@
 
 #pragma once
 
+#include "nut_budget.h"
 #include "nut_device.h"
+#include "nut_scheduler.h"
+#include "nut_shm_batch.h"
 #include "state_manager.h"
+#include <optional>
+#include <unordered_map>
 
 #define NUT_INVENTORY_REPEAT_AFTER_MS 3600000
+#define NUT_MAX_POLLING_WORKERS       64
+#define NUT_POLLING_BUDGET_PERCENT    80 // of the time, over which low priority work is shed
 
 class NUTAgent
 {
@@ -37,7 +44,32 @@ public:
     void setiClient(mlm_client_t* client);
 
     void updateDeviceList();
-    void onPoll();
+    /// reads and publishes the devices due at `now` (zclock_mono), see PollScheduler
+    /// @return false if no device was due
+    bool onPoll(uint64_t now);
+    /// when the next device is due, nothing if there is no device
+    std::optional<uint64_t> nextPoll() const
+    {
+        return _scheduler.next();
+    }
+    /// reads and publishes only the status of the devices, see NUTDeviceList::updateStatus()
+    void onStatusPoll();
+    /// reads and publishes the devices of one NUT device right away, on a notification of upsmon
+    /// @return the name of the NUT device
+    std::string onNotify(const std::string& upsName, const std::string& type);
+    /// receives one "UPSNAME/NOTIFYTYPE" notification (see fty-nut-notify) and handles it
+    /// @return the name of the NUT device, empty if the notification is malformed
+    std::string onNotify(zsock_t* notify);
+
+    /// endpoint receiving upsmon notifications (see fty-nut-notify), empty if disabled
+    void notifyEndpoint(const std::string& endpoint)
+    {
+        _notifyEndpoint = endpoint;
+    }
+    const std::string& notifyEndpoint() const
+    {
+        return _notifyEndpoint;
+    }
 
     void TTL(int ttl)
     {
@@ -48,24 +80,127 @@ public:
         return _ttl;
     };
 
+    /// number of threads reading NUT devices in parallel
+    void pollingWorkers(unsigned workers)
+    {
+        _deviceList.setWorkers(workers);
+    }
+    unsigned pollingWorkers() const
+    {
+        return _deviceList.workers();
+    }
+
+    /// polling interval in ms of devices without their own one
+    void polling(uint64_t interval)
+    {
+        _polling = interval;
+        reschedule();
+    }
+    uint64_t polling() const
+    {
+        return _polling;
+    }
+
+    /// polling intervals of device classes, like "ups=10,epdu=60"
+    /// @return false if rules are not valid (the old ones are kept)
+    bool devicePolling(const std::string& rules);
+
+    /// Publication interval in ms, 0 publishes every poll.
+    ///
+    /// Devices polled more often publish the mean of the samples taken
+    /// since their last publication, see NutPhysicsStore::Aggregate.
+    void publishInterval(uint64_t interval)
+    {
+        _publishInterval = interval;
+    }
+    uint64_t publishInterval() const
+    {
+        return _publishInterval;
+    }
+
+    /// publish also quantity.min and quantity.max of the samples along with the mean
+    void publishMinMax(bool enabled)
+    {
+        _publishMinMax = enabled;
+    }
+    bool publishMinMax() const
+    {
+        return _publishMinMax;
+    }
+
+    /// interval of the status lane in ms, 0 if disabled
+    void statusPolling(uint64_t interval)
+    {
+        _statusPolling = interval;
+    }
+    uint64_t statusPolling() const
+    {
+        return _statusPolling;
+    }
+
+    /// time spent in polling and work shed because of it
+    const PollBudget& budget() const
+    {
+        return _budget;
+    }
+
+    /// change thresholds of measurements, like "voltage.*=1,realpower.*=2%"
+    /// @return false if rules are not valid (the old ones are kept)
+    bool deadbands(const std::string& rules);
+
 protected:
-    std::string physicalQuantityShortName(const std::string& longName) const;
-    std::string physicalQuantityToUnits(const std::string& quantity) const;
-    void        advertisePhysics();
-    void        advertiseInventory();
+    /// publishes the devices whose publication is due, all of them if `force`
+    void        advertisePhysics(const std::vector<std::string>& names, bool force = false);
+    void        advertiseInventory(const std::vector<std::string>& names);
+    /// schedules the devices of the list with their intervals
+    void        reschedule();
+    /// polling interval of the device [ms]
+    uint64_t    interval(const drivers::nut::NUTDevice& device) const;
+    /// publication interval of the device [ms], never shorter than its polling one
+    uint64_t    publication(const drivers::nut::NUTDevice& device) const;
+    /// ttl of the metrics of the device, long enough for its publication interval
+    int         ttl(const drivers::nut::NUTDevice& device) const;
+    /// starts the shm batch of the device
+    void        beginBatch(const drivers::nut::NUTDevice& device);
+    /// publishes measurements and status of one device, the aggregates of the
+    /// measurements if `aggregates`
+    void        advertiseDevice(drivers::nut::NUTDevice& device, bool aggregates = false);
+    /// names of quantity.min and quantity.max
+    const std::pair<NameId, NameId>& companions(NameId quantity);
+    /// adds ups.alarm, status.ups and power.status of the device to the shm batch
+    void        advertiseStatus(const std::string& assetName, drivers::nut::NUTDevice& device);
+    /// sends the message as it is, on the metrics or on the inventory client
     int         send(const std::string& subject, zmsg_t** message_p);
     int         isend(const std::string& subject, zmsg_t** message_p);
 
-    int      _ttl        = 60;
-    uint64_t _lastUpdate = 0;
+    int      _ttl             = 60;
+    uint64_t _lastUpdate      = 0;
+    uint64_t _statusPolling   = 0;     //!< [ms] interval of the status lane, 0 if disabled
+    uint64_t _polling         = 30000; //!< [ms] default polling interval
+    uint64_t _publishInterval = 0;     //!< [ms] 0 to publish every poll
+    bool     _publishMinMax   = false; //!< see publishMinMax()
 
     drivers::nut::NUTDeviceList _deviceList;
-    uint64_t                    _inventoryTimestamp_ms =
-        0; // [ms] it is not an actual timestamp, it is just a reference point in time, when inventory was advertised
+    PollScheduler               _scheduler;     //!< next poll of each NUT device
+    PollingIntervals            _devicePolling; //!< intervals of device classes
+    PollBudget                  _budget{NUT_POLLING_BUDGET_PERCENT};
+    size_t                      _intervalDue     = 0; //!< NUT devices due in the current polling interval
+    size_t                      _intervalUpdated = 0; //!< devices updated in the current polling interval
+    ShmBatch                    _shmBatch{_unitNameToSymbol}; //!< metrics of the device being published
+    struct Inventory
+    {
+        uint64_t    timestamp = 0; //!< [ms] wall clock of the last whole inventory, see inventoryDue()
+        std::string topic; //!< "inventory@asset", built once
+    };
+    std::map<std::string, Inventory> _inventories; //!< by NUT device
+    // [ms] next publication of the devices sampled faster than they are published
+    std::map<std::string, uint64_t>                       _publications;
+    std::unordered_map<NameId, std::pair<NameId, NameId>> _companions; //!< see companions()
 
     static const std::map<std::string, std::string> _unitNameToSymbol;
 
     std::string                           _conf;
+    std::string                           _notifyEndpoint;
     mlm_client_t*                         _client  = nullptr;
     mlm_client_t*                         _iclient = nullptr;
     std::unique_ptr<StateManager::Reader> _state_reader;
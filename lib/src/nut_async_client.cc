@@ -0,0 +1,449 @@
+/*  =========================================================================
+    nut_async_client - non-blocking, pipelined client of NUT daemon
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_async_client.h"
+#include <cerrno>
+#include <cstring>
+#include <fty_log.h>
+#include <netdb.h>
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace drivers::nut {
+
+// ===========================================================================
+// NutResponseParser
+// ===========================================================================
+
+void NutResponseParser::expectListVar(const std::string& device, ListVarCallback callback)
+{
+    Request request;
+    request.list         = true;
+    request.device       = device;
+    request.listCallback = std::move(callback);
+    _requests.push_back(std::move(request));
+}
+
+void NutResponseParser::expectGetVar(const std::string& device, const std::string& name, GetVarCallback callback)
+{
+    Request request;
+    request.list        = false;
+    request.device      = device;
+    request.name        = name;
+    request.getCallback = std::move(callback);
+    _requests.push_back(std::move(request));
+}
+
+void NutResponseParser::reset()
+{
+    _requests.clear();
+    _buffer.clear();
+}
+
+std::vector<std::string> NutResponseParser::tokenize(std::string_view line)
+{
+    std::vector<std::string> tokens;
+    size_t                   i = 0;
+    while (i < line.size()) {
+        if (line[i] == ' ') {
+            i++;
+            continue;
+        }
+        std::string token;
+        if (line[i] == '"') {
+            // quoted string, \" and \\ are escaped
+            for (i++; i < line.size() && line[i] != '"'; i++) {
+                if (line[i] == '\\' && i + 1 < line.size()) {
+                    i++;
+                }
+                token += line[i];
+            }
+            i++; // closing quote
+        } else {
+            for (; i < line.size() && line[i] != ' '; i++) {
+                token += line[i];
+            }
+        }
+        tokens.push_back(std::move(token));
+    }
+    return tokens;
+}
+
+/// Parses `VAR <device> <name> "<value>"`, the value is unescaped into `value`.
+static bool s_parse_var(std::string_view line, std::string_view& device, std::string_view& name, std::string& value)
+{
+    if (line.substr(0, 4) != "VAR ") {
+        return false;
+    }
+    line.remove_prefix(4);
+    size_t space = line.find(' ');
+    if (space == std::string_view::npos) {
+        return false;
+    }
+    device = line.substr(0, space);
+    line.remove_prefix(space + 1);
+    space = line.find(' ');
+    if (space == std::string_view::npos) {
+        return false;
+    }
+    name = line.substr(0, space);
+    line.remove_prefix(space + 1);
+
+    value.clear();
+    if (line.empty() || line[0] != '"') {
+        value.assign(line);
+        return true;
+    }
+    for (size_t i = 1; i < line.size() && line[i] != '"'; i++) {
+        if (line[i] == '\\' && i + 1 < line.size()) {
+            i++;
+        }
+        value += line[i];
+    }
+    return true;
+}
+
+void NutResponseParser::feed(const char* data, size_t size)
+{
+    // lines are parsed in the received chunk, only an incomplete last line is copied
+    std::string_view input(data, size);
+    if (!_buffer.empty()) {
+        size_t end = input.find('\n');
+        if (end == std::string_view::npos) {
+            _buffer.append(input);
+            return;
+        }
+        _buffer.append(input.substr(0, end));
+        std::string line;
+        line.swap(_buffer);
+        processLine(line);
+        input.remove_prefix(end + 1);
+    }
+    for (;;) {
+        size_t end = input.find('\n');
+        if (end == std::string_view::npos) {
+            break;
+        }
+        processLine(input.substr(0, end));
+        input.remove_prefix(end + 1);
+    }
+    _buffer.assign(input);
+}
+
+void NutResponseParser::processLine(std::string_view line)
+{
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    if (_requests.empty()) {
+        throw std::runtime_error("unexpected response from NUT: " + std::string(line));
+    }
+    Request& request = _requests.front();
+
+    // the callback may queue another request, so pop this one first
+    auto finish = [this](const std::string& error, std::vector<std::string>&& value) {
+        Request done = std::move(_requests.front());
+        _requests.pop_front();
+        if (done.list) {
+            done.vars.seal();
+            done.listCallback(error, std::move(done.vars));
+        } else {
+            done.getCallback(error, std::move(value));
+        }
+    };
+
+    // the bulk of the traffic, parsed without tokenizing
+    std::string_view device, name;
+    if (s_parse_var(line, device, name, _value)) {
+        if (request.list && request.begun && device == request.device) {
+            request.vars.add(name, _value);
+            return;
+        }
+        if (!request.list && device == request.device && name == request.name) {
+            finish(std::string(), {_value});
+            return;
+        }
+        throw std::runtime_error("unexpected response from NUT for " + request.device + ": " + std::string(line));
+    }
+
+    auto tokens = tokenize(line);
+    auto is     = [&tokens](std::initializer_list<const char*> words) {
+        if (tokens.size() < words.size()) {
+            return false;
+        }
+        size_t i = 0;
+        for (auto word : words) {
+            if (tokens[i++] != word) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (tokens.size() >= 2 && tokens[0] == "ERR") {
+        finish(tokens[1], {});
+        return;
+    }
+    if (request.list && tokens.size() == 4 && tokens[3] == request.device) {
+        if (!request.begun && is({"BEGIN", "LIST", "VAR"})) {
+            request.begun = true;
+            return;
+        }
+        if (request.begun && is({"END", "LIST", "VAR"})) {
+            finish(std::string(), {});
+            return;
+        }
+    }
+    throw std::runtime_error("unexpected response from NUT for " + request.device + ": " + std::string(line));
+}
+
+// ===========================================================================
+// NutAsyncClient
+// ===========================================================================
+
+static std::string s_errno_string()
+{
+    return std::strerror(errno);
+}
+
+NutAsyncClient::~NutAsyncClient()
+{
+    disconnect();
+}
+
+void NutAsyncClient::connect(const std::string& host, int port, int timeoutMs)
+{
+    disconnect();
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* addresses = nullptr;
+    int              rv        = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+    if (rv != 0) {
+        throw std::runtime_error("can't resolve " + host + " (" + gai_strerror(rv) + ")");
+    }
+
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    if (_epoll < 0) {
+        freeaddrinfo(addresses);
+        throw std::runtime_error("epoll_create1 failed (" + s_errno_string() + ")");
+    }
+
+    std::string error = "no address";
+    for (auto address = addresses; address && _fd < 0; address = address->ai_next) {
+        int fd = socket(address->ai_family, address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0) {
+            error = s_errno_string();
+            continue;
+        }
+        if (::connect(fd, address->ai_addr, address->ai_addrlen) == 0) {
+            _fd = fd;
+            break;
+        }
+        if (errno != EINPROGRESS) {
+            error = s_errno_string();
+            close(fd);
+            continue;
+        }
+        // wait for the connection to be established
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLOUT;
+        epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event);
+        int n = epoll_wait(_epoll, &event, 1, timeoutMs);
+        epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+
+        int       soError = 0;
+        socklen_t length  = sizeof(soError);
+        if (n == 1 && getsockopt(fd, SOL_SOCKET, SO_ERROR, &soError, &length) == 0 && soError == 0) {
+            _fd = fd;
+            break;
+        }
+        error = n == 0 ? std::string("timeout") : std::string(std::strerror(soError ? soError : errno));
+        close(fd);
+    }
+    freeaddrinfo(addresses);
+
+    if (_fd < 0) {
+        disconnect();
+        throw std::runtime_error("can't connect to " + host + ":" + std::to_string(port) + " (" + error + ")");
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    epoll_ctl(_epoll, EPOLL_CTL_ADD, _fd, &event);
+}
+
+void NutAsyncClient::disconnect()
+{
+    if (_fd >= 0) {
+        close(_fd);
+        _fd = -1;
+    }
+    if (_epoll >= 0) {
+        close(_epoll);
+        _epoll = -1;
+    }
+    _wantWrite = false;
+    _parser.reset();
+    _unsent.clear();
+    _output.clear();
+}
+
+void NutAsyncClient::queue(std::string&& request)
+{
+    _unsent.push_back(std::move(request));
+}
+
+void NutAsyncClient::listVar(const std::string& device, ListVarCallback callback)
+{
+    _parser.expectListVar(device, std::move(callback));
+    queue("LIST VAR " + device + "\n");
+}
+
+void NutAsyncClient::getVar(const std::string& device, const std::string& name, GetVarCallback callback)
+{
+    _parser.expectGetVar(device, name, std::move(callback));
+    queue("GET VAR " + device + " " + name + "\n");
+}
+
+void NutAsyncClient::sendSome()
+{
+    // requests which are in _output, on the wire or being answered
+    size_t inFlight = _parser.pending() - _unsent.size();
+    while (!_unsent.empty() && inFlight < MAX_IN_FLIGHT) {
+        _output += _unsent.front();
+        _unsent.pop_front();
+        inFlight++;
+    }
+    while (!_output.empty()) {
+        ssize_t n = ::send(_fd, _output.data(), _output.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            throw std::runtime_error("send to NUT failed (" + s_errno_string() + ")");
+        }
+        _output.erase(0, size_t(n));
+    }
+}
+
+void NutAsyncClient::receiveSome()
+{
+    char buffer[16384];
+    for (;;) {
+        ssize_t n = ::recv(_fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            _parser.feed(buffer, size_t(n));
+            continue;
+        }
+        if (n == 0) {
+            if (_parser.pending()) {
+                throw std::runtime_error("connection closed by NUT");
+            }
+            // all requests have been answered, next run() reports the lost session
+            disconnect();
+            return;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        }
+        throw std::runtime_error("recv from NUT failed (" + s_errno_string() + ")");
+    }
+}
+
+void NutAsyncClient::updateEvents()
+{
+    bool wantWrite = !_output.empty();
+    if (wantWrite == _wantWrite) {
+        return;
+    }
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = wantWrite ? EPOLLIN | EPOLLOUT : EPOLLIN;
+    epoll_ctl(_epoll, EPOLL_CTL_MOD, _fd, &event);
+    _wantWrite = wantWrite;
+}
+
+void NutAsyncClient::run(int timeoutMs)
+{
+    if (!isConnected()) {
+        _parser.reset();
+        _unsent.clear();
+        throw std::runtime_error("not connected to NUT");
+    }
+    try {
+        sendSome();
+        while (_parser.pending()) {
+            updateEvents();
+            struct epoll_event event;
+            int                n = epoll_wait(_epoll, &event, 1, timeoutMs);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("epoll_wait failed (" + s_errno_string() + ")");
+            }
+            if (n == 0) {
+                // timeout is counted since the last activity, a long batch is fine
+                throw std::runtime_error("NUT did not respond in " + std::to_string(timeoutMs) + " ms");
+            }
+            if (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                receiveSome();
+            }
+            // received responses make room for further requests
+            sendSome();
+        }
+    } catch (...) {
+        disconnect();
+        throw;
+    }
+}
+
+NutSnapshot::DevicesVars NutAsyncClient::getDevicesVariableValues(const std::set<std::string>& devices)
+{
+    NutSnapshot::DevicesVars result;
+    for (const auto& device : devices) {
+        listVar(device, [&result, device](const std::string& error, NutSnapshot::DeviceVars&& vars) {
+            if (!error.empty()) {
+                log_debug("NUT device %s not read (%s)", device.c_str(), error.c_str());
+                return;
+            }
+            result.emplace(device, std::make_shared<const NutSnapshot::DeviceVars>(std::move(vars)));
+        });
+    }
+    run();
+    return result;
+}
+
+} // namespace drivers::nut
@@ -0,0 +1,155 @@
+/*  =========================================================================
+    nut_async_client - non-blocking, pipelined client of NUT daemon
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+/*
+ * nut::TcpClient waits for the answer of each request before it sends the
+ * next one. upsd answers the requests of one session strictly in order, so
+ * NutAsyncClient writes all queued requests back to back on one non-blocking
+ * socket and matches the responses to the requests as they stream in:
+ *
+ *     NutAsyncClient client;
+ *     client.connect("localhost", 3493);
+ *     client.listVar("ups-1", [](const std::string& error, NutSnapshot::DeviceVars&& vars) { ... });
+ *     client.getVar("epdu", "outlet.count", [](const std::string& error, std::vector<std::string>&& value) { ... });
+ *     client.run(); // returns when all callbacks have been called
+ *
+ * LIST VAR responses are parsed straight into a NutVarTable, without
+ * intermediate strings per variable.
+ *
+ * Callbacks get the NUT error code (e.g. "UNKNOWN-UPS") or an empty string.
+ * I/O and protocol errors are thrown as std::runtime_error and close the session.
+ */
+
+#include "nut_snapshot.h"
+#include <deque>
+#include <functional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace drivers::nut {
+
+/// Incremental parser of upsd responses.
+///
+/// Requests are registered with expect*() in the order they are sent, feed()
+/// accepts the received bytes in chunks of any size and calls the callback of
+/// a request as soon as its response is complete.
+class NutResponseParser
+{
+public:
+    typedef std::function<void(const std::string& error, NutSnapshot::DeviceVars&& vars)>     ListVarCallback;
+    typedef std::function<void(const std::string& error, std::vector<std::string>&& value)> GetVarCallback;
+
+    void expectListVar(const std::string& device, ListVarCallback callback);
+    void expectGetVar(const std::string& device, const std::string& name, GetVarCallback callback);
+
+    /// Parses next chunk of the response stream, throws std::runtime_error
+    /// on data which does not match the pending request.
+    void feed(const char* data, size_t size);
+
+    /// number of requests still waiting for (the rest of) their response
+    size_t pending() const
+    {
+        return _requests.size();
+    }
+
+    /// Forgets pending requests and buffered data (after the session was lost).
+    void reset();
+
+    /// Splits one line of NUT protocol to words, handles "quoted strings" and \-escapes.
+    static std::vector<std::string> tokenize(std::string_view line);
+
+private:
+    struct Request
+    {
+        bool                    list;
+        std::string             device;
+        std::string             name;
+        ListVarCallback         listCallback;
+        GetVarCallback          getCallback;
+        bool                    begun = false; //!< BEGIN LIST VAR received
+        NutSnapshot::DeviceVars vars;
+    };
+
+    void processLine(std::string_view line);
+
+    std::deque<Request> _requests;
+    std::string         _buffer; //!< incomplete last line
+    std::string         _value;  //!< unescaped value of the current line
+};
+
+/// Non-blocking session to upsd, keeps many requests in flight.
+class NutAsyncClient
+{
+public:
+    typedef NutResponseParser::ListVarCallback ListVarCallback;
+    typedef NutResponseParser::GetVarCallback  GetVarCallback;
+
+    NutAsyncClient() = default;
+    NutAsyncClient(const NutAsyncClient&) = delete;
+    NutAsyncClient& operator=(const NutAsyncClient&) = delete;
+    ~NutAsyncClient();
+
+    /// Opens the session, throws std::runtime_error on failure.
+    void connect(const std::string& host, int port, int timeoutMs = DEFAULT_TIMEOUT_MS);
+    void disconnect();
+    bool isConnected() const
+    {
+        return _fd >= 0;
+    }
+
+    /// Queues LIST VAR <device>, the callback gets all variables of the device.
+    void listVar(const std::string& device, ListVarCallback callback);
+
+    /// Queues GET VAR <device> <name>.
+    void getVar(const std::string& device, const std::string& name, GetVarCallback callback);
+
+    /// Sends the queued requests and dispatches the responses until no request
+    /// is pending. Throws std::runtime_error on I/O error or when the responses
+    /// do not arrive within timeoutMs.
+    void run(int timeoutMs = DEFAULT_TIMEOUT_MS);
+
+    /// Reads all variables of given devices with one pipelined batch of LIST VAR.
+    /// Devices unknown to upsd are left out of the result (like nut::Client).
+    NutSnapshot::DevicesVars getDevicesVariableValues(const std::set<std::string>& devices);
+
+    /// maximal number of requests sent without having their response
+    static constexpr size_t MAX_IN_FLIGHT      = 64;
+    static constexpr int    DEFAULT_TIMEOUT_MS = 10000;
+
+private:
+    void queue(std::string&& request);
+    void sendSome();
+    void receiveSome();
+    void updateEvents();
+
+    int                     _fd        = -1;
+    int                     _epoll     = -1;
+    bool                    _wantWrite = false;
+    NutResponseParser       _parser; //!< knows all queued requests, sent or not
+    std::deque<std::string> _unsent; //!< requests not passed to _output yet
+    std::string             _output; //!< bytes to be written to the socket
+};
+
+} // namespace drivers::nut
@@ -0,0 +1,108 @@
+/*  =========================================================================
+    nut_budget - time spent in polling against the time available
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_budget.h"
+#include <algorithm>
+
+PollBudget::PollBudget(unsigned percent)
+    : _percent(std::max(percent, 1u))
+{
+}
+
+void PollBudget::add(Phase phase, uint64_t us)
+{
+    _stats.phaseUs[int(phase)] += us;
+    _windowUs += us;
+}
+
+bool PollBudget::endCycle(uint64_t now, uint64_t window)
+{
+    _stats.cycles++;
+    if (_windowStart == 0) {
+        _windowStart = now;
+        return false;
+    }
+    uint64_t elapsed = now - _windowStart;
+    if (elapsed < std::max<uint64_t>(window, 1)) {
+        return false;
+    }
+
+    _load = unsigned(_windowUs / 10 / elapsed); // us / (ms * 1000) * 100
+    _windowStart = now;
+    _windowUs    = 0;
+
+    if (_load > _percent) {
+        _stats.overruns++;
+        _level = Level(std::min(int(_level) + 1, int(Measurements)));
+    } else if (_load < _percent / 2) {
+        _level = Level(std::max(int(_level) - 1, int(None)));
+    }
+    return true;
+}
+
+PollBudget::Level PollBudget::shedLevel(const std::string& quantity)
+{
+    // realpower.outlet.1, status.outlet.1, current.outlet.group.1, ...
+    if (quantity.find(".outlet.") != std::string::npos) {
+        return Outlets;
+    }
+    if (quantity.compare(0, 7, "status.") == 0 || quantity.compare(0, 10, "realpower.") == 0) {
+        return None;
+    }
+    return Measurements;
+}
+
+bool PollBudget::keepMetric(const std::string& quantity)
+{
+    if (_level == None) {
+        return true;
+    }
+    Level level = shedLevel(quantity);
+    if (level == None || level > _level) {
+        return true;
+    }
+    _stats.skippedMetrics++;
+    return false;
+}
+
+bool PollBudget::keepInventory(size_t count)
+{
+    if (_level < Inventory) {
+        return true;
+    }
+    _stats.skippedInventories += count;
+    return false;
+}
+
+const char* PollBudget::levelName(Level level)
+{
+    switch (level) {
+        case None:
+            return "nothing";
+        case Outlets:
+            return "outlet metrics";
+        case Inventory:
+            return "outlet metrics and inventory";
+        case Measurements:
+            return "all but status and realpower";
+    }
+    return "?";
+}
@@ -0,0 +1,118 @@
+/*  =========================================================================
+    nut_budget - time spent in polling against the time available
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/// Time spent per phase of the polling (fetch, transform, publish) over a
+/// window, against a budget in percent of the window.
+///
+/// While the polling is over budget, low priority work is shed step by step:
+/// outlet metrics first, then inventory, then measurements other than
+/// realpower. Status is never shed. The level goes back down once the load
+/// is at half of the budget.
+///
+///     budget.add(PollBudget::Phase::Fetch, fetchUs);
+///     ...
+///     if (budget.keepMetric(quantity)) publish(quantity);
+///     ...
+///     budget.endCycle(now, pollingInterval);
+class PollBudget
+{
+public:
+    enum class Phase
+    {
+        Fetch,     //!< reading variables from upsd
+        Transform, //!< mapping and deriving values
+        Publish,   //!< shm metrics and bus messages
+    };
+    static constexpr int PHASES = 3;
+
+    /// what is shed, each level sheds the previous ones too
+    enum Level
+    {
+        None         = 0,
+        Outlets      = 1, //!< metrics of outlets and outlet groups
+        Inventory    = 2, //!< inventory messages
+        Measurements = 3, //!< all measurements but realpower (status is always kept)
+    };
+
+    struct Stats
+    {
+        uint64_t phaseUs[PHASES]    = {}; //!< time spent per phase
+        uint64_t cycles             = 0;  //!< polling batches
+        uint64_t overruns           = 0;  //!< windows over budget
+        uint64_t skippedMetrics     = 0;  //!< metrics not published
+        uint64_t skippedInventories = 0;  //!< inventory messages not sent
+    };
+
+    explicit PollBudget(unsigned percent = 80);
+
+    /// share of the time the polling may take, in percent
+    unsigned percent() const
+    {
+        return _percent;
+    }
+
+    /// adds time spent in a phase of the current window
+    void add(Phase phase, uint64_t us);
+
+    /// Ends a polling batch at `now` [ms]. The shed level is evaluated once
+    /// per `window` ms (the polling interval). @return true if it was evaluated
+    bool endCycle(uint64_t now, uint64_t window);
+
+    Level level() const
+    {
+        return _level;
+    }
+
+    /// busy time of the last complete window, in percent
+    unsigned load() const
+    {
+        return _load;
+    }
+
+    /// @return false if the metric is shed at the current level (and counts it)
+    bool keepMetric(const std::string& quantity);
+
+    /// @return false if inventory of `count` devices is shed at the current level (and counts it)
+    bool keepInventory(size_t count = 1);
+
+    const Stats& stats() const
+    {
+        return _stats;
+    }
+
+    /// priority of a metric: the lowest level shedding it, 0 if never shed
+    static Level shedLevel(const std::string& quantity);
+
+    static const char* levelName(Level level);
+
+private:
+    unsigned _percent;
+    Level    _level       = None;
+    unsigned _load        = 0;
+    uint64_t _windowStart = 0; //!< [ms], 0 before the first cycle
+    uint64_t _windowUs    = 0; //!< busy time in the current window
+    Stats    _stats;
+};
@@ -0,0 +1,136 @@
+/*  =========================================================================
+    nut_connection - long-lived, auto-reconnecting session to NUT daemon
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_connection.h"
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <fty_log.h>
+
+namespace drivers::nut {
+
+static uint64_t s_now_ms()
+{
+    return uint64_t(
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+NutConnection::NutConnection(const std::string& host, int port)
+    : _host(host)
+    , _port(port)
+    , _random(std::random_device{}())
+{
+}
+
+NutConnection::~NutConnection()
+{
+    disconnect();
+}
+
+uint64_t NutConnection::backoffMs(unsigned failures, double jitter)
+{
+    if (failures == 0) {
+        return 0;
+    }
+    uint64_t delay = BACKOFF_MIN_MS;
+    for (unsigned i = 1; i < failures && delay < BACKOFF_MAX_MS; i++) {
+        delay *= 2;
+    }
+    delay = std::min(delay, BACKOFF_MAX_MS);
+    jitter = std::clamp(jitter, 0.0, 1.0);
+    // "equal jitter": keep half of the delay, randomize the other half
+    return delay / 2 + uint64_t(double(delay / 2) * jitter);
+}
+
+bool NutConnection::connect()
+{
+    auto start = s_now_ms();
+    try {
+        _client.connect(_host, _port);
+    } catch (std::exception& e) {
+        log_debug("connection to NUT %s:%d failed (%s)", _host.c_str(), _port, e.what());
+    } catch (...) {
+    }
+    auto end = s_now_ms();
+
+    if (!_client.isConnected()) {
+        _failures++;
+        _stats.failures++;
+        uint64_t delay = backoffMs(_failures, _jitter(_random));
+        _nextAttemptMs = end + delay;
+        log_error("Can't connect to NUT %s:%d (attempt %u), next attempt in %" PRIu64 " ms", _host.c_str(), _port,
+            _failures, delay);
+        return false;
+    }
+
+    _stats.connects++;
+    _stats.lastConnectMs = end - start;
+    if (_wasConnected || _failures) {
+        _stats.reconnects++;
+        _stats.totalReconnectMs += _stats.lastConnectMs;
+        log_info("Reconnected to NUT %s:%d in %" PRIu64 " ms (%" PRIu64 " reconnects, %" PRIu64 " ms in total)",
+            _host.c_str(), _port, _stats.lastConnectMs, _stats.reconnects, _stats.totalReconnectMs);
+    }
+    _failures      = 0;
+    _nextAttemptMs = 0;
+    _wasConnected  = true;
+    return true;
+}
+
+NutAsyncClient* NutConnection::client()
+{
+    if (_client.isConnected()) {
+        return &_client;
+    }
+    if (s_now_ms() < _nextAttemptMs) {
+        // still backing off after a failed attempt
+        return nullptr;
+    }
+    return connect() ? &_client : nullptr;
+}
+
+void NutConnection::invalidate()
+{
+    if (_client.isConnected()) {
+        log_warning("Dropping broken session to NUT %s:%d", _host.c_str(), _port);
+    }
+    try {
+        _client.disconnect();
+    } catch (...) {
+    }
+}
+
+void NutConnection::disconnect()
+{
+    try {
+        _client.disconnect();
+    } catch (...) {
+    }
+    _wasConnected = false;
+}
+
+bool NutConnection::isConnected() const
+{
+    return _client.isConnected();
+}
+
+} // namespace drivers::nut
@@ -0,0 +1,95 @@
+/*  =========================================================================
+    nut_connection - long-lived, auto-reconnecting session to NUT daemon
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "nut_async_client.h"
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace drivers::nut {
+
+/// Keeps one session to upsd open across polling cycles.
+///
+/// The session is (re)established lazily by client(). Once a request on the
+/// session fails, the owner calls invalidate() and the next client() call
+/// reconnects. Failed connection attempts are retried with exponential
+/// backoff and random jitter, so that a restarting upsd is not flooded with
+/// connection attempts.
+class NutConnection
+{
+public:
+    struct Stats
+    {
+        uint64_t connects         = 0; //!< successful connections, the first one included
+        uint64_t reconnects       = 0; //!< successful connections after a lost session
+        uint64_t failures         = 0; //!< failed connection attempts
+        uint64_t lastConnectMs    = 0; //!< duration of the last successful connection
+        uint64_t totalReconnectMs = 0; //!< time spent in successful reconnections
+    };
+
+    explicit NutConnection(const std::string& host = "localhost", int port = 3493);
+    NutConnection(const NutConnection&) = delete;
+    NutConnection& operator=(const NutConnection&) = delete;
+    ~NutConnection();
+
+    /// Returns the connected client, or nullptr if upsd is not reachable
+    /// (or a previous attempt failed and the backoff delay is not over yet).
+    NutAsyncClient* client();
+
+    /// Drops the session after a communication error, so that the next
+    /// client() call reconnects immediately.
+    void invalidate();
+
+    /// Closes the session for good.
+    void disconnect();
+
+    bool isConnected() const;
+
+    const Stats& stats() const
+    {
+        return _stats;
+    }
+
+    /// Delay before the next connection attempt after `failures`
+    /// consecutive failed attempts. Doubles from BACKOFF_MIN_MS up to
+    /// BACKOFF_MAX_MS; `jitter` in [0, 1) spreads the delay over its upper half.
+    static uint64_t backoffMs(unsigned failures, double jitter);
+
+    static constexpr uint64_t BACKOFF_MIN_MS = 500;
+    static constexpr uint64_t BACKOFF_MAX_MS = 30000;
+
+private:
+    bool connect();
+
+    std::string                            _host;
+    int                                    _port;
+    NutAsyncClient                         _client;
+    Stats                                  _stats;
+    bool                                   _wasConnected     = false; //!< a session existed and was lost
+    unsigned                               _failures         = 0;     //!< consecutive failed attempts
+    uint64_t                               _nextAttemptMs    = 0;     //!< monotonic time of next allowed attempt
+    std::mt19937                           _random;
+    std::uniform_real_distribution<double> _jitter{0.0, 1.0};
+};
+
+} // namespace drivers::nut
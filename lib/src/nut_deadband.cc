@@ -0,0 +1,185 @@
+/*  =========================================================================
+    nut_deadband - fixed-point measurements and their change thresholds
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_deadband.h"
+#include <charconv>
+#include <cmath>
+#include <fnmatch.h>
+#include <stdexcept>
+
+/// digits which surely fit into int64_t
+static constexpr size_t MAX_DIGITS = 18;
+
+static const int64_t s_pow10[MAX_DIGITS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+    1000000000, 10000000000, 100000000000, 1000000000000, 10000000000000, 100000000000000, 1000000000000000,
+    10000000000000000, 100000000000000000, 1000000000000000000};
+
+static bool s_digits(std::string_view text)
+{
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<FixedPoint> FixedPoint::parse(std::string_view text)
+{
+    bool negative = false;
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+        negative = text[0] == '-';
+        text.remove_prefix(1);
+    }
+    std::string_view integer  = text;
+    std::string_view fraction = {};
+    auto             dot      = text.find('.');
+    if (dot != std::string_view::npos) {
+        integer  = text.substr(0, dot);
+        fraction = text.substr(dot + 1);
+    }
+    if ((integer.empty() && fraction.empty()) || integer.size() + fraction.size() > MAX_DIGITS ||
+        !s_digits(integer) || !s_digits(fraction)) {
+        return std::nullopt;
+    }
+
+    // from_chars does not accept a sign or an empty string, both handled above
+    uint64_t integerValue  = 0;
+    uint64_t fractionValue = 0;
+    if (!integer.empty()) {
+        std::from_chars(integer.data(), integer.data() + integer.size(), integerValue);
+    }
+    if (!fraction.empty()) {
+        std::from_chars(fraction.data(), fraction.data() + fraction.size(), fractionValue);
+    }
+
+    FixedPoint result;
+    result.decimals = uint8_t(fraction.size());
+    result.mantissa = int64_t(integerValue) * s_pow10[result.decimals] + int64_t(fractionValue);
+    if (negative) {
+        result.mantissa = -result.mantissa;
+    }
+    return result;
+}
+
+size_t FixedPoint::format(char* buffer) const
+{
+    uint64_t magnitude = mantissa < 0 ? uint64_t(0) - uint64_t(mantissa) : uint64_t(mantissa);
+    char     digits[MAX_TEXT];
+    auto     count = size_t(std::to_chars(digits, digits + sizeof(digits), magnitude).ptr - digits);
+
+    char* out = buffer;
+    if (mantissa < 0) {
+        *out++ = '-';
+    }
+    size_t integerDigits = count > decimals ? count - decimals : 0;
+    if (integerDigits == 0) {
+        *out++ = '0';
+    }
+    for (size_t i = 0; i < integerDigits; i++) {
+        *out++ = digits[i];
+    }
+    if (decimals) {
+        *out++ = '.';
+        // 5 with 2 decimals is 0.05
+        for (size_t i = count; i < decimals; i++) {
+            *out++ = '0';
+        }
+        for (size_t i = integerDigits; i < count; i++) {
+            *out++ = digits[i];
+        }
+    }
+    *out = '\0';
+    return size_t(out - buffer);
+}
+
+std::string FixedPoint::toString() const
+{
+    char buffer[MAX_TEXT];
+    return std::string(buffer, format(buffer));
+}
+
+double FixedPoint::toDouble() const
+{
+    return double(mantissa) / double(s_pow10[decimals < MAX_DIGITS ? decimals : MAX_DIGITS]);
+}
+
+bool Deadband::exceeded(const FixedPoint& stored, const FixedPoint& value) const
+{
+    double difference = std::fabs(value.toDouble() - stored.toDouble());
+    if (absolute > 0 || percent > 0) {
+        return (absolute > 0 && difference > absolute) ||
+               (percent > 0 && difference > std::fabs(stored.toDouble()) * percent / 100);
+    }
+    return difference != 0;
+}
+
+DeadbandRules DeadbandRules::parse(const std::string& rules)
+{
+    DeadbandRules result;
+    size_t        start = 0;
+    while (start < rules.size()) {
+        size_t end = rules.find(',', start);
+        if (end == std::string::npos) {
+            end = rules.size();
+        }
+        std::string rule = rules.substr(start, end - start);
+        start            = end + 1;
+
+        // trim spaces
+        rule.erase(0, rule.find_first_not_of(" \t"));
+        rule.erase(rule.find_last_not_of(" \t") + 1);
+        if (rule.empty()) {
+            continue;
+        }
+        auto equal = rule.find('=');
+        if (equal == std::string::npos || equal == 0) {
+            throw std::invalid_argument("deadband rule '" + rule + "' is not pattern=value[%]");
+        }
+        std::string pattern = rule.substr(0, equal);
+        std::string value   = rule.substr(equal + 1);
+        pattern.erase(pattern.find_last_not_of(" \t") + 1);
+        value.erase(0, value.find_first_not_of(" \t"));
+
+        bool percent = !value.empty() && value.back() == '%';
+        if (percent) {
+            value.pop_back();
+        }
+        auto number = FixedPoint::parse(value);
+        if (!number || number->mantissa < 0) {
+            throw std::invalid_argument("deadband rule '" + rule + "' has no valid value");
+        }
+        Deadband band;
+        (percent ? band.percent : band.absolute) = number->toDouble();
+        result._rules.emplace_back(pattern, band);
+    }
+    return result;
+}
+
+Deadband DeadbandRules::match(const std::string& quantity) const
+{
+    for (const auto& rule : _rules) {
+        if (fnmatch(rule.first.c_str(), quantity.c_str(), 0) == 0) {
+            return rule.second;
+        }
+    }
+    return Deadband();
+}
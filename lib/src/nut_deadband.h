@@ -0,0 +1,80 @@
+/*  =========================================================================
+    nut_deadband - fixed-point measurements and their change thresholds
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Decimal number as sent by NUT: mantissa / 10^decimals, so "229.30" is
+/// {22930, 2} and is formatted back to the same text.
+struct FixedPoint
+{
+    int64_t mantissa = 0;
+    uint8_t decimals = 0;
+
+    /// longest text of format(), NUL included
+    static constexpr size_t MAX_TEXT = 24;
+
+    /// Parses "[-+]digits[.digits]" (up to 18 digits), nullopt for anything else.
+    static std::optional<FixedPoint> parse(std::string_view text);
+
+    /// Writes the number NUL terminated to buffer of MAX_TEXT chars, returns its length.
+    size_t format(char* buffer) const;
+    std::string toString() const;
+
+    double toDouble() const;
+};
+
+/// Change threshold of a measurement, the default one reports any change.
+struct Deadband
+{
+    double absolute = 0; //!< in the unit of the quantity
+    double percent  = 0; //!< of the last stored value
+
+    /// true if `value` differs from the `stored` one by more than the deadband
+    bool exceeded(const FixedPoint& stored, const FixedPoint& value) const;
+};
+
+/// Deadbands by glob pattern of the 42ity quantity name, the first matching pattern wins.
+///
+///     auto rules = DeadbandRules::parse("voltage.*=1,realpower.*=2%");
+///     rules.match("voltage.input.L1"); // absolute 1 (V)
+class DeadbandRules
+{
+public:
+    /// Parses comma separated pattern=value[%], throws std::invalid_argument.
+    static DeadbandRules parse(const std::string& rules);
+
+    Deadband match(const std::string& quantity) const;
+
+    bool empty() const
+    {
+        return _rules.empty();
+    }
+
+private:
+    std::vector<std::pair<std::string, Deadband>> _rules;
+};
@@ -0,0 +1,356 @@
+/*  =========================================================================
+    nut_derivation - values computed from the NUT variables of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_derivation.h"
+#include "nut_deadband.h"
+#include "nut_key.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+/// Resolves the rules against the variables a device has. Mirrors the rules
+/// step by step, tracking which variables exist once the previous steps ran.
+struct NutDerivation::Compiler
+{
+    const std::string&         prefix;
+    const uint32_t             device; //!< daisy-chain index of the prefix
+    const NutVarTable&         vars;
+    std::vector<Step>&         steps;
+    std::vector<NameId>        derived;   //!< targets of the steps so far
+    std::optional<std::string> phases;    //!< output.phases, reported or derived
+
+    NameId id(const std::string& name) const
+    {
+        return NutNames.id(prefix, name);
+    }
+
+    bool has(const std::string& name) const
+    {
+        auto found = NutNames.find(prefix, name);
+        return found && has(*found);
+    }
+
+    bool has(NameId name) const
+    {
+        return vars.has(name) || std::find(derived.begin(), derived.end(), name) != derived.end();
+    }
+
+    void add(Op op, NameId target, std::vector<NameId> sources, std::string value = {}, std::string from = {})
+    {
+        derived.push_back(target);
+        steps.push_back(Step{op, target, std::move(sources), std::move(value), std::move(from)});
+    }
+
+    void setIfNotPresent(const std::string& dst, const std::string& src)
+    {
+        if (!has(dst) && has(src)) {
+            add(Op::Copy, id(dst), {id(src)});
+        }
+    }
+
+    void phasesOf(const std::string& direction)
+    {
+        std::string name = direction + ".phases";
+        if (has(name)) {
+            return;
+        }
+        if (has(direction + ".L3-N.voltage") || has(direction + ".L3.current")) {
+            add(Op::Set, id(name), {}, "3");
+        } else {
+            add(Op::Set, id(name), {}, "1");
+        }
+        if (direction == "output") {
+            phases = steps.back().value;
+        }
+    }
+
+    void realpowerFromOutput()
+    {
+        // XXX: Use the mapping info rather than hardcoding these (they both map
+        // to realpower.default)
+        if (has("ups.realpower") || has("input.realpower")) {
+            return;
+        }
+
+        // use outlet.realpower if exists
+        if (has("outlet.realpower")) {
+            setIfNotPresent("ups.realpower", "outlet.realpower");
+            return;
+        }
+        // sum the output.Lx.realpower
+        if (has("output.L1.realpower")) {
+            static const NameId outputPhase = NutNames.id("output.L#.realpower");
+            static const NameId upsPhase    = NutNames.id("ups.L#.realpower");
+
+            int phaseCount = 1;
+            try {
+                phaseCount = std::stoi(phases.value_or("1"));
+            } catch (...) {
+            }
+            std::vector<NameId> sources;
+            for (int i = 1; i <= phaseCount; i++) {
+                NameId output = NutKeys.name(outputPhase, uint32_t(i), device);
+                NameId ups    = NutKeys.name(upsPhase, uint32_t(i), device);
+                if (has(output)) {
+                    sources.push_back(output);
+                } else if (has(ups)) {
+                    sources.push_back(ups);
+                } else {
+                    // even output is missing, can't compute
+                    break;
+                }
+            }
+            add(Op::Sum, id("ups.realpower"), std::move(sources));
+            return;
+        }
+
+        // if we have outlets, sum them
+        if (has("outlet.1.realpower")) {
+            static const NameId outletRealpower = NutNames.id("outlet.#.realpower");
+
+            int count = 100;
+            if (auto value = vars.get(prefix, "outlet.count")) {
+                try {
+                    count = std::stoi(std::string(*value));
+                } catch (...) {
+                }
+            }
+            std::vector<NameId> sources;
+            for (int outlet = 1; outlet <= count; outlet++) {
+                NameId name = NutKeys.name(outletRealpower, uint32_t(outlet), device);
+                if (!has(name)) {
+                    // end of outlets
+                    break;
+                }
+                sources.push_back(name);
+            }
+            add(Op::SumValid, id("ups.realpower"), std::move(sources));
+            return;
+        }
+
+        // mainly for STS/ATS - if we have output voltage and current let's multiply them
+        if (has("output.current") && has("output.voltage")) {
+            add(Op::Product, id("ups.realpower"), {id("output.current"), id("output.voltage")});
+        }
+    }
+
+    void fixMissingLoad()
+    {
+        if (has("ups.load")) {
+            return;
+        }
+        // computed load goes to ups.load of the whole device
+        NameId load = NutNames.id("ups.load");
+        if (phases == std::string("1")) {
+            // 1 phase ups, try realpower/max_power*100
+            if (has("ups.realpower")) {
+                add(Op::LoadFromPower, load, {id("ups.realpower")});
+            }
+            return;
+        }
+        // 3 phase ups, try ups.LX.load
+        if (has("ups.L1.load") && has("ups.L2.load") && has("ups.L3.load")) {
+            add(Op::LoadAverage, load, {id("ups.L1.load"), id("ups.L2.load"), id("ups.L3.load")});
+            return;
+        }
+        // try sum(realpower_i)/max_power*100
+        if (has("output.L1.realpower") && has("output.L2.realpower") && has("output.L3.realpower")) {
+            add(Op::LoadFromPower, load,
+                {id("output.L1.realpower"), id("output.L2.realpower"), id("output.L3.realpower")});
+        }
+    }
+
+    void compile()
+    {
+        // number of input and output phases
+        phasesOf("input");
+        phasesOf("output");
+
+        // pdu replace with epdu
+        if (has("device.type")) {
+            add(Op::Replace, id("device.type"), {}, "epdu", "pdu");
+        }
+        // sum the realpower from output information
+        realpowerFromOutput();
+        // variables, that differs from ups to ups
+        setIfNotPresent("ups.realpower", "input.realpower");
+        setIfNotPresent("input.L1.realpower", "input.realpower");
+        setIfNotPresent("input.L1.realpower", "ups.realpower");
+        setIfNotPresent("output.L1.realpower", "output.realpower");
+        // take input realpower and present it as output if output is not present
+        // and also the opposite way
+        for (const auto& variable : {"realpower", "L1.realpower", "L2.realpower", "L3.realpower"}) {
+            std::string outvar = std::string("output.") + variable;
+            std::string invar  = std::string("input.") + variable;
+            setIfNotPresent(outvar, invar);
+            setIfNotPresent(invar, outvar);
+        }
+        // sum the realpower again if still not present
+        // hope that missing output values have been filled
+        // from input values
+        realpowerFromOutput();
+        // ups load
+        fixMissingLoad();
+    }
+};
+
+void NutDerivation::compile(const std::string& prefix, const NutVarTable& vars)
+{
+    _steps.clear();
+    _phasesName  = NutNames.id(prefix, "output.phases");
+    _outletsName = NutNames.id(prefix, "outlet.count");
+
+    std::optional<std::string> phases;
+    if (auto value = vars.get(_phasesName)) {
+        phases = std::string(*value);
+    }
+    Compiler compiler{prefix, NutKeys.key(_outletsName).device, vars, _steps, {}, phases};
+    compiler.compile();
+
+    _compiled = true;
+    _schema   = vars.schema();
+    _phases   = phases;
+    _outlets.reset();
+    if (auto value = vars.get(_outletsName)) {
+        _outlets = std::string(*value);
+    }
+    _compilations++;
+}
+
+/// Value of a variable as a number, false if missing or not a number
+static bool s_number(const NutVarTable& vars, NameId name, double& number)
+{
+    auto value = vars.get(name);
+    if (!value) {
+        return false;
+    }
+    auto fixed = FixedPoint::parse(*value);
+    if (!fixed) {
+        return false;
+    }
+    number = fixed->toDouble();
+    return true;
+}
+
+/// Sets the value rounded to two decimals, without trailing ".00"
+static void s_setRounded(NutVarTable& vars, NameId name, double value)
+{
+    FixedPoint fixed{int64_t(std::llround(value * 100)), 2};
+    if (fixed.mantissa % 100 == 0) {
+        fixed = FixedPoint{fixed.mantissa / 100, 0};
+    }
+    char buffer[FixedPoint::MAX_TEXT];
+    vars.set(name, std::string_view(buffer, fixed.format(buffer)));
+}
+
+/// Sets the value formatted like std::to_string(double)
+static void s_setDouble(NutVarTable& vars, NameId name, double value)
+{
+    char buffer[64];
+    int  length = snprintf(buffer, sizeof(buffer), "%f", value);
+    vars.set(name, std::string_view(buffer, size_t(length)));
+}
+
+bool NutDerivation::run(const Step& step, NutVarTable& vars, double maxPower) const
+{
+    switch (step.op) {
+        case Op::Set:
+            vars.set(step.target, step.value);
+            return true;
+        case Op::Copy:
+            // source may be missing if its own computation failed
+            if (auto value = vars.get(step.sources[0])) {
+                vars.set(step.target, *value);
+            }
+            return true;
+        case Op::Replace:
+            if (vars.get(step.target) == std::string_view(step.from)) {
+                vars.set(step.target, step.value);
+            }
+            return true;
+        case Op::Sum:
+        case Op::SumValid: {
+            double sum = 0.0;
+            for (NameId source : step.sources) {
+                double value;
+                if (s_number(vars, source, value)) {
+                    sum += value;
+                } else if (step.op == Op::Sum) {
+                    break;
+                }
+            }
+            s_setRounded(vars, step.target, sum);
+            return true;
+        }
+        case Op::Product: {
+            double current, voltage;
+            if (!s_number(vars, step.sources[0], current) || !s_number(vars, step.sources[1], voltage)) {
+                return false;
+            }
+            s_setRounded(vars, step.target, current * voltage);
+            return true;
+        }
+        case Op::LoadFromPower: {
+            if (std::isnan(maxPower) || maxPower * 1000 <= 0.1) {
+                return true;
+            }
+            double sum = 0.0;
+            for (NameId source : step.sources) {
+                double value;
+                if (!s_number(vars, source, value)) {
+                    return false;
+                }
+                sum += value;
+            }
+            s_setDouble(vars, step.target, std::round(sum / (maxPower * 1000) * 100.0));
+            return true;
+        }
+        case Op::LoadAverage: {
+            double sum = 0.0;
+            for (NameId source : step.sources) {
+                double value;
+                if (!s_number(vars, source, value)) {
+                    return false;
+                }
+                sum += value;
+            }
+            s_setDouble(vars, step.target, sum / double(step.sources.size()));
+            return true;
+        }
+    }
+    return true;
+}
+
+bool NutDerivation::apply(const std::string& prefix, NutVarTable& vars, double maxPower)
+{
+    if (vars.empty()) {
+        return true;
+    }
+    if (!_compiled || _schema != vars.schema() || vars.get(_phasesName) != _phases ||
+        vars.get(_outletsName) != _outlets) {
+        compile(prefix, vars);
+    }
+    bool result = true;
+    for (const auto& step : _steps) {
+        result = run(step, vars, maxPower) && result;
+    }
+    return result;
+}
@@ -0,0 +1,96 @@
+/*  =========================================================================
+    nut_derivation - values computed from the NUT variables of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "nut_var_table.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Derived variables of one device: number of phases, ups.realpower from
+/// whatever source the device has, ups.load, ...
+///
+/// Which source supplies which variable depends only on the set of variables
+/// the device reports, its number of output phases and outlets. Rules are
+/// resolved into a list of steps once per such schema, each cycle only runs
+/// the arithmetic of those steps on the current values.
+///
+///     NutVarTable vars(&nutVars);
+///     derivation.apply(prefix, vars, maxPower());
+class NutDerivation
+{
+public:
+    /// Adds derived variables of the device with `prefix` to the layer `vars`,
+    /// resolving the steps again if the schema of `vars` has changed.
+    /// `maxPower` is the max_power of the asset in kW, NAN if unknown.
+    /// @return false if some value could not be computed (not a number)
+    bool apply(const std::string& prefix, NutVarTable& vars, double maxPower);
+
+    /// number of times the steps were resolved
+    size_t compilations() const
+    {
+        return _compilations;
+    }
+
+    /// number of steps run per cycle
+    size_t size() const
+    {
+        return _steps.size();
+    }
+
+private:
+    enum class Op
+    {
+        Set,           //!< target = value
+        Copy,          //!< target = sources[0], if present
+        Replace,       //!< target = value, if it is from
+        Sum,           //!< target = sum of sources, stops on the first invalid one
+        SumValid,      //!< target = sum of valid sources
+        Product,       //!< target = sources[0] * sources[1]
+        LoadFromPower, //!< target = round(sum of sources / max_power * 100)
+        LoadAverage,   //!< target = average of sources
+    };
+
+    struct Step
+    {
+        Op                  op;
+        NameId              target;
+        std::vector<NameId> sources;
+        std::string         value;
+        std::string         from;
+    };
+
+    struct Compiler;
+
+    void compile(const std::string& prefix, const NutVarTable& vars);
+
+    bool run(const Step& step, NutVarTable& vars, double maxPower) const;
+
+    std::vector<Step>          _steps;
+    bool                       _compiled     = false;
+    uint64_t                   _schema       = 0; //!< of the variables the steps were resolved for
+    std::optional<std::string> _phases;           //!< output.phases the steps were resolved for
+    std::optional<std::string> _outlets;          //!< outlet.count the steps were resolved for
+    NameId                     _phasesName   = 0;
+    NameId                     _outletsName  = 0;
+    size_t                     _compilations = 0;
+};
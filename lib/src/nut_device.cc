@@ -31,6 +31,8 @@
 #include <fty_common_nut.h>
 #include <fty_log.h>
 #include <iostream>
+#include <set>
+#include <thread>
 
 #define NUT_MEASUREMENT_REPEAT_AFTER 300 //!< (once in 5 minutes now (300s))
 
@@ -45,51 +47,82 @@ NUTDevice::NUTDevice()
 
 NUTDevice::NUTDevice(const AssetState::Asset* asset)
     : _asset(asset)
+    , _daisyChain(asset->daisychain())
     , _nutName(asset->name())
 {
 }
 
 NUTDevice::NUTDevice(const AssetState::Asset* asset, const std::string& nut_name)
     : _asset(asset)
+    , _daisyChain(asset->daisychain())
     , _nutName(nut_name)
 {
 }
 
-std::string NUTDevice::daisyPrefix() const
+const std::string& NUTDevice::daisyPrefix() const
 {
-    if (daisyChainIndex()) {
-        return "device." + std::to_string(daisyChainIndex()) + ".";
+    return NutKeys.prefix(uint32_t(daisyChainIndex()));
+}
+
+void NUTDevice::indexFamilies()
+{
+    // names are only added, but by clear()
+    size_t names = _physics.size() + _inventory.size();
+    if (names == _indexedNames) {
+        return;
     }
-    return "";
+    _indexedNames = names;
+    _families.clear();
+
+    auto add = [this](NameId name) {
+        NutKey key = NutKeys.key(name);
+        if (key.collection == NutKey::Collection::None || key.index == 0) {
+            return;
+        }
+        auto& elements = _families[key.family];
+        if (elements.size() < key.index) {
+            elements.resize(key.index, 0);
+        }
+        elements[key.index - 1] = name;
+    };
+    for (const auto& item : _physics) {
+        add(item.name);
+    }
+    for (const auto& item : _inventory) {
+        add(item.name);
+    }
+    // NameId 0 is the empty name, a missing element
+    for (auto& family : _families) {
+        family.second.erase(std::find(family.second.begin(), family.second.end(), 0), family.second.end());
+    }
+}
+
+const std::vector<NameId>& NUTDevice::family(NameId family) const
+{
+    static const std::vector<NameId> none;
+
+    auto it = _families.find(family);
+    return it == _families.end() ? none : it->second;
 }
 
 /// change getters
 bool NUTDevice::changed() const
 {
-    for (auto& it : _physics) {
-        if (it.second.changed)
-            return true;
-    }
-    for (auto& it : _inventory) {
-        if (it.second.changed)
-            return true;
-    }
-    return false;
+    return _physics.changed() || _inventory.changed();
 }
 
 bool NUTDevice::changed(const char* name) const
 {
-    auto iterP = _physics.find(name);
-    if (iterP != _physics.end()) {
-        // this is a number, value exists
-        return iterP->second.changed;
+    auto id = NutNames.find(name);
+    if (!id) {
+        return false;
     }
-    auto iterI = _inventory.find(name);
-    if (iterI != _inventory.end()) {
-        // this is a inventory string, value exists
-        return iterI->second.changed;
+    if (_physics.has(*id)) {
+        // this is a number, value exists
+        return _physics.changed(*id);
     }
-    return false;
+    // inventory string or nothing
+    return _inventory.changed(*id);
 }
 
 bool NUTDevice::changed(const std::string& name) const
@@ -102,158 +135,105 @@ bool NUTDevice::changed(const std::string& name) const
  */
 void NUTDevice::setChanged(const bool status)
 {
-    for (auto& it : _physics) {
-        it.second.changed = status;
-    }
-    for (auto& it : _inventory) {
-        it.second.changed = status;
-    }
+    _physics.setChanged(status);
+    _inventory.setChanged(status);
 }
 
 void NUTDevice::setChanged(const char* name, const bool status)
 {
-    auto iterP = _physics.find(name);
-    if (iterP != _physics.end()) {
-        // this is a number, value exists
-        iterP->second.changed = status;
-    }
-    auto iterI = _inventory.find(name);
-    if (iterI != _inventory.end()) {
-        // this is a inventory string, value exists
-        iterI->second.changed = status;
+    auto id = NutNames.find(name);
+    if (!id) {
+        return;
     }
+    setChanged(*id, status);
 }
 
-void NUTDevice::setChanged(const std::string& name, const bool status)
+void NUTDevice::setChanged(NameId name, const bool status)
 {
-    setChanged(name.c_str(), status);
+    _physics.setChanged(name, status);
+    _inventory.setChanged(name, status);
 }
 
-void NUTDevice::updatePhysics(const std::string& varName, const std::string& newValue)
+void NUTDevice::setChanged(const std::string& name, const bool status)
 {
-    if (_physics.count(varName) == 0) {
-        // this is new value
-        struct NUTPhysicalValue pvalue;
-        pvalue.changed    = true;
-        pvalue.value      = "0";
-        pvalue.candidate  = newValue;
-        _physics[varName] = pvalue;
-    } else {
-        _physics[varName].candidate = newValue;
-    }
+    setChanged(name.c_str(), status);
 }
 
-
-void NUTDevice::commitChanges()
+void NUTDevice::updatePhysics(NameId varName, std::string_view newValue, const DeadbandRules& deadbands)
 {
-    for (auto& item : _physics) {
-        if (item.second.value != item.second.candidate) {
-            item.second.value   = item.second.candidate;
-            item.second.changed = true;
-        }
-    }
+    _physics.set(varName, newValue, deadbands);
 }
 
-void NUTDevice::updateInventory(const std::string& varName, const std::string& inventory)
+bool NUTDevice::updateInventory(NameId varName, std::string_view inventory)
 {
+    static const NameId s_type = NutNames.id("type");
+
     // NUT bug type pdu => epdu
-    if (varName == "type" && inventory == "pdu") {
+    if (varName == s_type && inventory == "pdu") {
         return updateInventory(varName, "epdu");
     }
-    if (_inventory.count(varName) == 0) {
-        // this is new value
-        struct NUTInventoryValue ivalue;
-        ivalue.changed      = true;
-        ivalue.value        = inventory;
-        _inventory[varName] = ivalue;
-    } else {
-        if (_inventory[varName].value != inventory) {
-            _inventory[varName].value   = inventory;
-            _inventory[varName].changed = true;
-        }
-    }
+    return _inventory.set(varName, inventory);
 }
 
-static std::string collapse_commas(const std::vector<std::string>& values)
+void NUTDevice::update(
+    const NutVarTable& nutVars, const NutMapping& mapping, const DeadbandRules& deadbands, bool /*forceUpdate*/)
 {
-    std::string inventory = "";
-    for (size_t i = 0; i < values.size(); ++i) {
-        inventory += values[i];
-        if (i < values.size() - 1) {
-            inventory += ", ";
-        }
-    }
-    return inventory;
-}
-
-void NUTDevice::update(std::map<std::string, std::vector<std::string>>    vars,
-    std::function<const std::map<std::string, std::string>&(const char*)> mapping, bool /*forceUpdate*/)
-{
-    if (vars.empty()) {
+    if (nutVars.empty()) {
         return;
     }
 
-    const std::string prefix   = daisyPrefix();
-    const int         prefixId = daisyChainIndex();
+    const std::string& prefix   = daisyPrefix();
+    const int          prefixId = daisyChainIndex();
     _lastUpdate                = time(NULL);
 
-    // Use transformation table first.
-    NUTValuesTransformation(prefix, vars);
-
-    fty::nut::KeyValues scalarVars;
-    for (auto var : vars) {
-        scalarVars.emplace(var.first, collapse_commas(var.second));
+    // Compute derived values first. Those go to a layer over the variables
+    // read from NUT, which are shared with other actors.
+    NutVarTable vars(&nutVars);
+    size_t      compilations = _derivation.compilations();
+    if (!_derivation.apply(prefix, vars, maxPower())) {
+        log_error("failed to calculate derived values of %s", assetName().c_str());
+    }
+    if (_derivation.compilations() != compilations) {
+        log_debug("derived values of %s resolved into %zu steps", assetName().c_str(), _derivation.size());
     }
 
     // Translate NUT keys into 42ity keys.
-    {
-        auto mappedPhysics = fty::nut::performMapping(mapping("physicsMapping"), scalarVars, prefixId);
-        for (auto value : mappedPhysics) {
-            updatePhysics(value.first, value.second);
-        }
-    }
-    {
-        auto mappedInventory = fty::nut::performMapping(mapping("inventoryMapping"), scalarVars, prefixId);
-        for (auto value : mappedInventory) {
-            updateInventory(value.first, value.second);
+    thread_local std::vector<NutMapping::Value> mapped;
+    mapping.apply(vars, prefixId, mapped);
+    for (const auto& value : mapped) {
+        if (value.mapping == NUTDeviceList::PHYSICS_MAPPING) {
+            updatePhysics(value.name, value.value, deadbands);
+        } else {
+            updateInventory(value.name, value.value);
         }
     }
-
-    commitChanges();
+    indexFamilies();
 }
 
-std::string NUTDevice::itof(const long int X) const
+bool NUTDevice::updateStatus(const NutVarTable& nutVars, const NutMapping& mapping)
 {
-    std::string num, dec, sig;
-    long int    AX;
-
-    if (X < 0) {
-        sig = "-";
-    } else {
-        sig = "";
-    }
-    AX  = abs(X);
-    num = std::to_string(AX / 100);
-    dec = std::to_string(AX % 100);
-    if (dec.size() == 1)
-        dec = "0" + dec;
-    if (dec == "00") {
-        return sig + num;
-    } else {
-        return sig + num + "." + dec;
+    thread_local std::vector<NutMapping::Value> mapped;
+    mapping.apply(nutVars, daisyChainIndex(), mapped);
+    bool changed = false;
+    for (const auto& value : mapped) {
+        if (value.mapping == NUTDeviceList::INVENTORY_MAPPING) {
+            changed = updateInventory(value.name, value.value) || changed;
+        }
     }
+    indexFamilies();
+    return changed;
 }
 
 std::string NUTDevice::toString() const
 {
     std::string msg = "", val;
-    for (auto it : _physics) {
-        msg += "\"" + it.first + "\":" + it.second.value + ", ";
+    for (const auto& it : _physics) {
+        msg += "\"" + NutNames.name(it.name) + "\":" + std::string(it.value) + ", ";
     }
-    for (auto it : _inventory) {
-        val = it.second.value;
+    for (const auto& it : _inventory) {
+        val = it.value;
         std::replace(val.begin(), val.end(), '"', ' ');
-        msg += "\"" + it.first + "\":\"" + val + "\", ";
+        msg += "\"" + NutNames.name(it.name) + "\":\"" + val + "\", ";
     }
     if (msg.size() > 2) {
         msg = msg.substr(0, msg.size() - 2);
@@ -264,11 +244,11 @@ std::string NUTDevice::toString() const
 std::map<std::string, std::string> NUTDevice::properties() const
 {
     std::map<std::string, std::string> map;
-    for (auto it : _physics) {
-        map[it.first] = it.second.value;
+    for (const auto& it : _physics) {
+        map[NutNames.name(it.name)] = it.value;
     }
-    for (auto it : _inventory) {
-        map[it.first] = it.second.value;
+    for (const auto& it : _inventory) {
+        map[NutNames.name(it.name)] = it.value;
     }
     return map;
 }
@@ -277,8 +257,8 @@ std::map<std::string, std::string> NUTDevice::physics(bool onlyChanged) const
 {
     std::map<std::string, std::string> map;
     for (const auto& it : _physics) {
-        if ((!onlyChanged) || it.second.changed) {
-            map[it.first] = it.second.value;
+        if ((!onlyChanged) || it.changed) {
+            map[NutNames.name(it.name)] = it.value;
         }
     }
     return map;
@@ -288,8 +268,8 @@ std::map<std::string, std::string> NUTDevice::inventory(bool onlyChanged) const
 {
     std::map<std::string, std::string> map;
     for (const auto& it : _inventory) {
-        if ((!onlyChanged) || it.second.changed) {
-            map[it.first] = it.second.value;
+        if ((!onlyChanged) || it.changed) {
+            map[NutNames.name(it.name)] = it.value;
         }
     }
     return map;
@@ -298,15 +278,8 @@ std::map<std::string, std::string> NUTDevice::inventory(bool onlyChanged) const
 
 bool NUTDevice::hasProperty(const char* name) const
 {
-    if (_physics.count(name) != 0) {
-        // this is a number and value exists
-        return true;
-    }
-    if (_inventory.count(name) != 0) {
-        // this is a inventory string, value exists
-        return true;
-    }
-    return false;
+    auto id = NutNames.find(name);
+    return id && (_physics.has(*id) || _inventory.has(*id));
 }
 
 bool NUTDevice::hasProperty(const std::string& name) const
@@ -316,11 +289,8 @@ bool NUTDevice::hasProperty(const std::string& name) const
 
 bool NUTDevice::hasPhysics(const char* name) const
 {
-    if (_physics.count(name) != 0) {
-        // this is a number and value exists
-        return true;
-    }
-    return false;
+    auto id = NutNames.find(name);
+    return id && _physics.has(*id);
 }
 
 bool NUTDevice::hasPhysics(const std::string& name) const
@@ -331,15 +301,17 @@ bool NUTDevice::hasPhysics(const std::string& name) const
 
 std::string NUTDevice::property(const char* name) const
 {
-    auto iterP = _physics.find(name);
-    if (iterP != _physics.end()) {
+    auto id = NutNames.find(name);
+    if (!id) {
+        return "";
+    }
+    if (auto value = _physics.get(*id)) {
         // this is a number, value exists
-        return iterP->second.value;
+        return *value;
     }
-    auto iterI = _inventory.find(name);
-    if (iterI != _inventory.end()) {
+    if (auto value = _inventory.get(*id)) {
         // this is a inventory string, value exists
-        return iterI->second.value;
+        return std::string(*value);
     }
     return "";
 }
@@ -349,349 +321,348 @@ std::string NUTDevice::property(const std::string& name) const
     return property(name.c_str());
 }
 
-void NUTDevice::NUTSetIfNotPresent(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars,
-    const std::string& dst, const std::string& src)
+void NUTDevice::clear()
 {
-    if (vars.find(prefix + dst) == vars.cend()) {
-        const auto& it = vars.find(prefix + src);
-        if (it != vars.cend())
-            vars[prefix + dst] = it->second;
+    if (!_inventory.empty() || !_physics.empty()) {
+        _inventory.clear();
+        _physics.clear();
+        _families.clear();
+        _indexedNames = 0;
+        log_error("Dropping all measurement/inventory data for %s", assetName().c_str());
     }
 }
 
-void NUTDevice::NUTRealpowerFromOutput(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars)
+NUTDevice::~NUTDevice()
 {
-
-    // XXX: Use the mapping info rather than hardcoding these (they both map
-    // to realpower.default)
-    if (vars.find(prefix + "ups.realpower") != vars.end()) {
-        return;
-    }
-    if (vars.find(prefix + "input.realpower") != vars.end()) {
-        return;
-    }
-
-    // use outlet.realpower if exists
-    if (vars.find(prefix + "outlet.realpower") != vars.end()) {
-        NUTSetIfNotPresent(prefix, vars, "ups.realpower", "outlet.realpower");
-        log_debug("realpower of %s taken from outlet.realpower", assetName().c_str());
-        return;
-    }
-    // sum the output.Lx.realpower
-    if (vars.find(prefix + "output.L1.realpower") != vars.end()) {
-        int phases = 1;
-        if (vars.find(prefix + "output.phases") != vars.end()) {
-            try {
-                phases = std::stoi(vars[prefix + "output.phases"][0]);
-            } catch (...) {
-            }
-        }
-        double sum = 0.0;
-        for (int i = 1; i <= phases; i++) {
-            auto it = vars.find(prefix + "output.L" + std::to_string(i) + ".realpower");
-
-            if (it == vars.end()) {
-                it = vars.find(prefix + "ups.L" + std::to_string(i) + ".realpower");
-
-                if (it == vars.end()) {
-                    // even output is missing, can't compute
-                    break;
-                }
-            }
-            try {
-                sum += std::stod(it->second[0]);
-            } catch (...) {
-                break;
-            }
-        }
-        // we have sum
-        log_debug("realpower of %s calculated as sum of output.Lx.realpower", assetName().c_str());
-        std::vector<std::string> value;
-        value.push_back(itof(int32_t(round(sum * 100))));
-        vars[prefix + "ups.realpower"] = value;
-        return;
-    }
-
-    // if we have outlets, sum them
-    if (vars.find(prefix + "outlet.1.realpower") != vars.end()) {
-        double sum   = 0.0;
-        int    count = 100;
-        auto   cntit = vars.find(prefix + "outlet.count");
-        if (cntit != vars.end()) {
-            try {
-                count = std::stoi(cntit->second[0]);
-            } catch (...) {
-            }
-        }
-        for (int outlet = 1; outlet <= count; outlet++) {
-            auto it = vars.find(prefix + "outlet." + std::to_string(outlet) + ".realpower");
-            if (it == vars.end()) {
-                // end of outlets
-                break;
-            }
-            try {
-                sum += std::stod(it->second[0]);
-            } catch (...) {
-            }
-        }
-        log_debug("realpower of %s calculated as sum of outlet.X.realpower", assetName().c_str());
-        std::vector<std::string> value;
-        value.push_back(itof(int32_t(round(sum * 100))));
-        vars[prefix + "ups.realpower"] = value;
-        return;
-    }
-
-    // mainly for STS/ATS - if we have output voltage and current let's multiply them
-    {
-        auto it_current = vars.find(prefix + "output.current");
-        auto it_voltage = vars.find(prefix + "output.voltage");
-        if ((it_current != vars.end()) && (it_voltage != vars.end())) {
-            try {
-                double                   power = std::stod(it_current->second[0]) * std::stod(it_voltage->second[0]);
-                std::vector<std::string> value;
-                value.push_back(itof(int32_t(round(power * 100))));
-                vars[prefix + "ups.realpower"] = value;
-                log_debug("ats, realpower");
-                return;
-            } catch (...) {
-                log_error("Exception in power = current*voltage calculation");
-            }
-        }
-    }
 }
 
-void NUTDevice::NUTFixMissingLoad(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars)
+NUTDeviceList::NUTDeviceList()
 {
-    if (vars.find(prefix + "ups.load") != vars.end())
-        return;
-    try {
-        if (vars[prefix + "output.phases"][0] == "1") {
-            // 1 phase ups
-            {
-                // try realpower/max_power*100
-                double max_power = maxPower();
-                if (!std::isnan(max_power)) {
-                    max_power *= 1000;
-                    const auto realpower_it = vars.find(prefix + "ups.realpower");
-                    if (realpower_it != vars.cend()) {
-                        double realpower = std::stod(realpower_it->second[0]);
-                        if (max_power > 0.1) {
-                            std::string load = std::to_string(round((realpower / max_power) * 100.0));
-                            vars["ups.load"] = {load};
-                            return;
-                        }
-                    }
-                }
-            }
-        } else {
-            // 3 phase ups
-            {
-                // try ups.LX.load
-                const auto it1 = vars.find(prefix + "ups.L1.load");
-                const auto it2 = vars.find(prefix + "ups.L2.load");
-                const auto it3 = vars.find(prefix + "ups.L3.load");
-                if ((it1 != vars.cend()) && (it2 != vars.cend()) && (it3 != vars.cend())) {
-                    std::string load = std::to_string(
-                        (std::stod(it1->second[0]) + std::stod(it2->second[0]) + std::stod(it3->second[0])) / 3.0);
-                    vars["ups.load"] = {load};
-                    return;
-                }
-            }
-            {
-                // try sum(realpower_i)/max_power*100
-                double max_power = maxPower();
-                if (!std::isnan(max_power)) {
-                    max_power *= 1000;
-                    if (max_power > 0.1) {
-                        const auto it1 = vars.find(prefix + "output.L1.realpower");
-                        const auto it2 = vars.find(prefix + "output.L2.realpower");
-                        const auto it3 = vars.find(prefix + "output.L3.realpower");
-                        if ((it1 != vars.cend()) && (it2 != vars.cend()) && (it3 != vars.cend())) {
-                            std::string load = std::to_string(round(
-                                (std::stod(it1->second[0]) + std::stod(it2->second[0]) + std::stod(it3->second[0])) /
-                                max_power * 100.0));
-                            vars["ups.load"] = {load};
-                            return;
-                        }
-                    }
-                }
-            }
-        }
-    } catch (...) {
-        log_error("failed to calculate load for %s", assetName().c_str());
-    }
+    setWorkers(1);
 }
 
-void NUTDevice::NUTValuesTransformation(
-    const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars)
+void NUTDeviceList::setWorkers(unsigned workers)
 {
-    if (vars.empty())
+    workers = std::max(workers, 1u);
+    if (workers == _connections.size()) {
         return;
-
-    // number of input phases
-    if (vars.find(prefix + "input.phases") == vars.end()) {
-        if (vars.find(prefix + "input.L3-N.voltage") != vars.end() ||
-            vars.find(prefix + "input.L3.current") != vars.end()) {
-            vars[prefix + "input.phases"] = {"3"};
-        } else {
-            vars[prefix + "input.phases"] = {"1"};
-        }
-    }
-
-    // number of output phases
-    if (vars.find(prefix + "output.phases") == vars.end()) {
-        if (vars.find(prefix + "output.L3-N.voltage") != vars.end() ||
-            vars.find(prefix + "output.L3.current") != vars.end()) {
-            vars[prefix + "output.phases"] = {"3"};
-        } else {
-            vars[prefix + "output.phases"] = {"1"};
-        }
     }
-    {
-        // pdu replace with epdu
-        auto it = vars.find(prefix + "device.type");
-        if (it != vars.end()) {
-            if (!it->second.empty() && it->second[0] == "pdu")
-                it->second[0] = "epdu";
+    log_info("Reading NUT devices with %u worker(s)", workers);
+    // sessions of removed workers are closed by NutConnection destructor
+    _connections.resize(workers);
+    for (auto& connection : _connections) {
+        if (!connection) {
+            connection = std::make_unique<NutConnection>(_host, _port);
         }
     }
-    // sum the realpower from output information
-    NUTRealpowerFromOutput(prefix, vars);
-    // variables, that differs from ups to ups
-    NUTSetIfNotPresent(prefix, vars, "ups.realpower", "input.realpower");
-    NUTSetIfNotPresent(prefix, vars, "input.L1.realpower", "input.realpower");
-    NUTSetIfNotPresent(prefix, vars, "input.L1.realpower", "ups.realpower");
-    NUTSetIfNotPresent(prefix, vars, "output.L1.realpower", "output.realpower");
-    // take input realpower and present it as output if output is not present
-    // and also the opposite way
-    for (const auto& variable : {"realpower", "L1.realpower", "L2.realpower", "L3.realpower"}) {
-        std::string outvar = "output.";
-        outvar.append(variable);
-        std::string invar = "input.";
-        invar.append(variable);
-        NUTSetIfNotPresent(prefix, vars, outvar, invar);
-        NUTSetIfNotPresent(prefix, vars, invar, outvar);
-    }
-    // sum the realpower again if still not present
-    // hope that missing output values have been filled
-    // from input values
-    NUTRealpowerFromOutput(prefix, vars);
-    // ups load
-    NUTFixMissingLoad(prefix, vars);
 }
 
-void NUTDevice::clear()
+void NUTDeviceList::setServer(const std::string& host, int port)
 {
-    if (!_inventory.empty() || !_physics.empty()) {
-        _inventory.clear();
-        _physics.clear();
-        log_error("Dropping all measurement/inventory data for %s", assetName().c_str());
+    _host = host;
+    _port = port;
+    for (auto& connection : _connections) {
+        connection = std::make_unique<NutConnection>(_host, _port);
     }
 }
 
-NUTDevice::~NUTDevice()
-{
-}
-
-NUTDeviceList::NUTDeviceList()
+NutConnection::Stats NUTDeviceList::connectionStats() const
 {
+    NutConnection::Stats total;
+    for (const auto& connection : _connections) {
+        const auto& stats = connection->stats();
+        total.connects += stats.connects;
+        total.reconnects += stats.reconnects;
+        total.failures += stats.failures;
+        total.lastConnectMs = std::max(total.lastConnectMs, stats.lastConnectMs);
+        total.totalReconnectMs += stats.totalReconnectMs;
+    }
+    return total;
 }
 
 void NUTDeviceList::updateDeviceList(const AssetState& deviceState)
 {
     try {
-        auto& devices = deviceState.getPowerDevices();
-
-        _devices.clear();
-        for (auto i : devices) {
+        auto& assets = deviceState.getPowerDevices();
+
+        // Devices which are still read from the same NUT device keep their
+        // values and changed flags, only the asset they refer to is replaced
+        // (the old one belongs to the previous state).
+        std::map<std::string, NUTDevice> devices;
+        size_t                           kept = 0;
+        for (auto i : assets) {
             const std::string& ip = i.second->IP();
             if (ip.empty()) {
                 // this is strange. No IP?
                 continue;
             }
-            const std::string& name = i.first;
+            const std::string& name    = i.first;
+            std::string        nutName = name;
             switch (i.second->daisychain()) {
                 case 0:
                 case 1:
-                    _devices[name] = NUTDevice(i.second.get());
                     break;
                 default:
-                    auto master = deviceState.ip2master(ip);
-                    if (master.empty()) {
+                    nutName = deviceState.ip2master(ip);
+                    if (nutName.empty()) {
                         log_error("Daisychain host for %s not found", name.c_str());
-                    } else {
-                        _devices[name] = NUTDevice(i.second.get(), master);
+                        continue;
                     }
                     break;
             }
+            auto old = _devices.find(name);
+            if (old != _devices.end() && old->second._nutName == nutName &&
+                old->second._daisyChain == i.second->daisychain()) {
+                auto node            = _devices.extract(old);
+                node.mapped()._asset = i.second.get();
+                devices.insert(std::move(node));
+                kept++;
+            } else {
+                devices[name] = NUTDevice(i.second.get(), nutName);
+            }
         }
+        // what is left is not a power device anymore or has been replaced
+        for (const auto& removed : _devices) {
+            _changed.erase(removed.first);
+        }
+        log_debug("device list updated: %zu kept, %zu new, %zu removed", kept, devices.size() - kept,
+            _devices.size());
+        _devices.swap(devices);
     } catch (const std::exception& e) {
         log_error("exception while configuring device: %s", e.what());
     }
 }
 
 
-void NUTDeviceList::updateDeviceStatus(bool forceUpdate)
+static uint64_t s_elapsedUs(std::chrono::steady_clock::time_point since)
+{
+    return uint64_t(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+int NUTDeviceList::updateShard(NutConnection& connection, const std::vector<NUTDevice*>& devices,
+    NutSnapshot::DevicesVars& data, std::vector<std::string>& changed, Cost& cost, bool forceUpdate)
 {
     auto start = std::chrono::steady_clock::now();
 
-    std::set<std::string> allDevices;
-    for (const auto& device : _devices) {
-        allDevices.insert(device.second.nutName());
+    std::set<std::string> nutNames;
+    for (const auto device : devices) {
+        nutNames.insert(device->nutName());
+    }
+    // The session is kept open between cycles, so it may have been closed
+    // by upsd in the meantime. Give it one more try on a fresh session.
+    bool fetched = false;
+    for (int attempt = 0; attempt < 2 && !fetched; attempt++) {
+        auto client = connection.client();
+        if (!client) {
+            break;
+        }
+        try {
+            data    = client->getDevicesVariableValues(nutNames);
+            fetched = true;
+        } catch (std::exception& e) {
+            log_error("Major communication problem with NUT (%s)", e.what());
+            connection.invalidate();
+        }
     }
-    std::map<std::string, std::map<std::string, std::vector<std::string>>> allData;
-    try {
-        allData = nutClient.getDevicesVariableValues(allDevices);
-    } catch (std::exception& e) {
-        log_error("Major communication problem with NUT (%s)", e.what());
+
+    cost.fetchUs = s_elapsedUs(start);
+    if (!fetched) {
+        return -1;
     }
+    start        = std::chrono::steady_clock::now();
 
     int updatedDevices = 0;
-    for (auto& device : _devices) {
-        auto it = allData.find(device.second.nutName());
-        if (it != allData.end()) {
-            std::function<const std::map<std::string, std::string>&(const char*)> x =
-                std::bind(&NUTDeviceList::get_mapping, this, std::placeholders::_1);
-            device.second.update(it->second, x, forceUpdate);
-            log_debug("Updated device status %s", device.first.c_str());
+    for (auto device : devices) {
+        auto vars = data.find(device->nutName());
+        if (vars != data.end()) {
+            device->update(*vars->second, _mapping, _deadbands, forceUpdate);
+            log_debug("Updated device status %s", device->assetName().c_str());
             updatedDevices++;
+            if (device->changed()) {
+                changed.push_back(device->assetName());
+            }
         } else {
-            log_error("Communication problem with %s", device.first.c_str());
-            if (time(NULL) - device.second.lastUpdate() > NUT_MEASUREMENT_REPEAT_AFTER / 2) {
+            log_error("Communication problem with %s", device->assetName().c_str());
+            if (time(NULL) - device->lastUpdate() > NUT_MEASUREMENT_REPEAT_AFTER / 2) {
                 // we are not communicating for a while. Let's drop the values.
-                device.second.clear();
+                device->clear();
             }
         }
     }
+    cost.transformUs = s_elapsedUs(start);
+    return updatedDevices;
+}
+
+int NUTDeviceList::updateDeviceStatus(const std::vector<NUTDevice*>& devices, bool forceUpdate)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    // Devices are spread over the workers by NUT name, so that devices of one
+    // daisy chain (same NUT name) are read by the same worker only once.
+    std::vector<std::vector<NUTDevice*>> shards(std::min(_connections.size(), std::max<size_t>(devices.size(), 1)));
+    std::map<std::string, size_t>        shardOf;
+    for (auto device : devices) {
+        auto it = shardOf.emplace(device->nutName(), shardOf.size() % shards.size()).first;
+        shards[it->second].push_back(device);
+    }
+
+    std::vector<NutSnapshot::DevicesVars>   data(shards.size());
+    std::vector<std::vector<std::string>> changed(shards.size());
+    std::vector<int>                        updated(shards.size(), -1);
+    std::vector<Cost>                       costs(shards.size());
+    if (shards.size() == 1) {
+        updated[0] = updateShard(*_connections[0], shards[0], data[0], changed[0], costs[0], forceUpdate);
+    } else {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < shards.size(); i++) {
+            if (shards[i].empty()) {
+                continue;
+            }
+            threads.emplace_back([this, i, &shards, &data, &changed, &updated, &costs, forceUpdate]() {
+                try {
+                    updated[i] =
+                        updateShard(*_connections[i], shards[i], data[i], changed[i], costs[i], forceUpdate);
+                } catch (std::exception& e) {
+                    log_error("NUT polling worker %zu failed (%s)", i, e.what());
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    NutSnapshot::DevicesVars allData;
+    int                      updatedDevices = 0;
+    bool                     reachable      = false;
+    _lastCost = Cost();
+    for (size_t i = 0; i < shards.size(); i++) {
+        _lastCost.fetchUs     = std::max(_lastCost.fetchUs, costs[i].fetchUs);
+        _lastCost.transformUs = std::max(_lastCost.transformUs, costs[i].transformUs);
+        allData.merge(data[i]);
+        _changed.insert(changed[i].begin(), changed[i].end());
+        if (updated[i] >= 0) {
+            updatedDevices += updated[i];
+            reachable = true;
+        }
+    }
+    if (devices.size() < _devices.size() && _snapshot) {
+        // other devices keep what they had, unless they are gone
+        const auto& previous = _snapshot->devices();
+        for (const auto& device : _devices) {
+            const std::string& nutName = device.second.nutName();
+            if (!allData.count(nutName) && !shardOf.count(nutName)) {
+                auto vars = previous.find(nutName);
+                if (vars != previous.end()) {
+                    allData.emplace(nutName, vars->second);
+                }
+            }
+        }
+    }
+    // when NUT is unreachable, consumers get an empty snapshot
+    _snapshot = std::make_shared<const NutSnapshot>(std::move(allData), ++_generation);
+    if (!reachable && !devices.empty()) {
+        return -1;
+    }
 
     auto end = std::chrono::steady_clock::now();
-    log_info("Updated %d/%d devices in %.3f seconds", updatedDevices, _devices.size(),
-        std::chrono::duration_cast<std::chrono::milliseconds>(end - start) / 1000.0);
+    log_debug("Updated %d/%zu devices in %.3f seconds (%zu workers)", updatedDevices, devices.size(),
+        std::chrono::duration<double>(end - start).count(), shards.size());
+    return updatedDevices;
 }
 
-bool NUTDeviceList::connect()
+void NUTDeviceList::update(bool forceUpdate)
 {
-    try {
-        nutClient.connect("localhost", 3493);
-    } catch (...) {
+    std::vector<NUTDevice*> devices;
+    for (auto& device : _devices) {
+        devices.push_back(&device.second);
     }
-    return nutClient.isConnected();
+    updateDeviceStatus(devices, forceUpdate);
 }
 
-void NUTDeviceList::disconnect()
+std::vector<std::string> NUTDeviceList::update(const std::vector<std::string>& nutNames, bool forceUpdate)
 {
-    try {
-        nutClient.disconnect();
-    } catch (...) {
+    std::set<std::string>    wanted(nutNames.begin(), nutNames.end());
+    std::vector<std::string> names;
+    std::vector<NUTDevice*>  devices;
+    for (auto& device : _devices) {
+        if (wanted.count(device.second.nutName())) {
+            names.push_back(device.first);
+            devices.push_back(&device.second);
+        }
+    }
+    if (devices.empty() || updateDeviceStatus(devices, forceUpdate) < 0) {
+        names.clear();
     }
+    return names;
 }
 
-void NUTDeviceList::update(bool forceUpdate)
+const std::vector<std::string> NUTDeviceList::NUT_STATUS_VARIABLES = {"ups.status", "ups.alarm", "ups.test.result"};
+
+std::vector<std::string> NUTDeviceList::updateStatus()
 {
-    if (connect()) {
-        updateDeviceStatus(forceUpdate);
-        disconnect();
+    std::vector<std::string> changed;
+    if (_devices.empty() || !_mappingLoaded) {
+        return changed;
+    }
+    // same thread as the full update, the session of the first worker is free
+    NutConnection&  connection = *_connections.front();
+    NutAsyncClient* client     = connection.client();
+    if (!client) {
+        return changed;
     }
+
+    // one table per NUT device, shared by the members of a daisy chain: the
+    // plain variables are read once, the "device.N." ones once per member
+    std::map<std::string, std::set<std::string>> names;
+    for (auto& device : _devices) {
+        auto&              variables = names[device.second.nutName()];
+        const std::string& prefix    = device.second.daisyPrefix();
+        for (const auto& variable : NUT_STATUS_VARIABLES) {
+            // daisy-chained devices may have their own status, the mapping picks the right one
+            variables.insert(variable);
+            if (!prefix.empty()) {
+                variables.insert(prefix + variable);
+            }
+        }
+    }
+    std::map<std::string, NutVarTable> tables;
+    try {
+        for (const auto& device : names) {
+            NutVarTable& table = tables[device.first];
+            for (const auto& name : device.second) {
+                client->getVar(device.first, name,
+                    [&table, name](const std::string& error, std::vector<std::string>&& value) {
+                        // VAR-NOT-SUPPORTED, DATA-STALE, ... just leave the variable out
+                        if (error.empty()) {
+                            std::string joined;
+                            for (const auto& item : value) {
+                                joined += joined.empty() ? item : ", " + item;
+                            }
+                            table.add(name, joined);
+                        }
+                    });
+            }
+        }
+        client->run();
+    } catch (std::exception& e) {
+        log_error("Reading status from NUT failed (%s)", e.what());
+        connection.invalidate();
+        return changed;
+    }
+
+    for (auto& table : tables) {
+        table.second.seal();
+    }
+    for (auto& device : _devices) {
+        const NutVarTable& table = tables[device.second.nutName()];
+        if (!table.empty() && device.second.updateStatus(table, _mapping)) {
+            changed.push_back(device.first);
+            _changed.insert(device.first);
+        }
+    }
+    return changed;
 }
 
 size_t NUTDeviceList::size() const
@@ -714,13 +685,29 @@ std::map<std::string, NUTDevice>::iterator NUTDeviceList::end()
     return _devices.end();
 }
 
+std::map<std::string, NUTDevice>::iterator NUTDeviceList::find(const std::string& name)
+{
+    return _devices.find(name);
+}
+
 bool NUTDeviceList::changed() const
 {
-    for (auto& it : _devices) {
-        if (it.second.changed())
-            return true;
+    return !changedDevices().empty();
+}
+
+const std::set<std::string>& NUTDeviceList::changedDevices() const
+{
+    // devices are flagged back by their consumers (or removed from the
+    // list) behind our back, drop those from the set
+    for (auto it = _changed.begin(); it != _changed.end();) {
+        auto device = _devices.find(*it);
+        if (device == _devices.end() || !device->second.changed()) {
+            it = _changed.erase(it);
+        } else {
+            ++it;
+        }
     }
-    return false;
+    return _changed;
 }
 
 void NUTDeviceList::load_mapping(const char* path_to_file)
@@ -736,12 +723,22 @@ void NUTDeviceList::load_mapping(const char* path_to_file)
         _inventoryMapping = fty::nut::loadMapping(path_to_file, "inventoryMapping");
         log_debug("Number of entries loaded for inventory mapping: %zu", _inventoryMapping.size());
 
+        // indexes must match PHYSICS_MAPPING and INVENTORY_MAPPING
+        _mapping.load({_physicsMapping, _inventoryMapping});
         _mappingLoaded = true;
     } catch (std::exception& e) {
         log_error("Couldn't load mapping: %s", e.what());
     }
 }
 
+void NUTDeviceList::setDeadbands(const DeadbandRules& deadbands)
+{
+    _deadbands = deadbands;
+    for (auto& device : _devices) {
+        device.second._physics.deadbands(_deadbands);
+    }
+}
+
 bool NUTDeviceList::mappingLoaded() const
 {
     return _mappingLoaded;
@@ -761,7 +758,6 @@ const std::map<std::string, std::string>& NUTDeviceList::get_mapping(const char*
 
 NUTDeviceList::~NUTDeviceList()
 {
-    disconnect();
 }
 
 } // namespace drivers::nut
@@ -25,28 +25,24 @@
 // Original authors: Tomas Halman, Karol Hrdina, Alena Chernikava
 
 #include "asset_state.h"
+#include "nut_connection.h"
+#include "nut_derivation.h"
+#include "nut_key.h"
+#include "nut_mapping.h"
+#include "nut_snapshot.h"
+#include "nut_value_store.h"
 #include <functional>
 #include <map>
+#include <memory>
 #include <nutclient.h>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 namespace nutclient = nut;
 
 namespace drivers::nut {
 
-struct NUTInventoryValue
-{
-    bool        changed;
-    std::string value;
-};
-
-struct NUTPhysicalValue
-{
-    bool        changed;
-    std::string value;
-    std::string candidate;
-};
-
 /// Class for keeping status information of one UPS/ePDU/...
 /// Keeps inventory, status and measurement values of one device as it is presented by NUT.
 class NUTDevice
@@ -64,6 +60,12 @@ public:
     /// Returns true if there are some changes in device since last statusMessage has been called.
     bool changed() const;
 
+    /// Returns number of changed properties.
+    size_t changedCount() const
+    {
+        return _physics.changedCount() + _inventory.changedCount();
+    }
+
     /// Returns true if property has changed since last check.
     bool changed(const char* name) const;
     bool changed(const std::string& name) const;
@@ -74,6 +76,13 @@ public:
     /// Set status of particular property
     void setChanged(const char* name, const bool status);
     void setChanged(const std::string& name, const bool status);
+    void setChanged(NameId name, const bool status);
+
+    /// Sets status of all physical properties
+    void setPhysicsChanged(const bool status)
+    {
+        _physics.setChanged(status);
+    }
 
     /// Produces a std::string with device status in JSON format.
     /// @return std::string
@@ -110,6 +119,39 @@ public:
     /// @return bool, true if property exists
     std::map<std::string, std::string> inventory(bool onlyChanged) const;
 
+    /// Physical values and their changed flags, without copying.
+    ///
+    ///    for (const auto& item : UPS.physicsValues()) {
+    ///        cout << NutNames.name(item.name) << " " << item.value << "\n";
+    ///    }
+    const NutPhysicsStore& physicsValues() const
+    {
+        return _physics;
+    }
+
+    /// Starts new min/max/mean of the physical values, see NutPhysicsStore::Aggregate.
+    void resetAggregates()
+    {
+        _physics.resetAggregates();
+    }
+
+    /// Inventory values and their changed flags, without copying.
+    const NutValueStore& inventoryValues() const
+    {
+        return _inventory;
+    }
+
+    /// Names of the elements of an indexed family the device has, by element
+    /// index from 1, e.g. of "status.outlet.#" (see NutKey):
+    ///
+    ///     for (NameId name : UPS.family(NutNames.id("status.outlet.#"))) {
+    ///         cout << NutNames.name(name) << " " << *UPS.inventoryValues().get(name) << "\n";
+    ///     }
+    ///
+    /// Empty if the device has none. Elements are numbered without gaps, the
+    /// list stops at the first missing one.
+    const std::vector<NameId>& family(NameId family) const;
+
     /// method returns particular device property.
     /// @return std::string, property value as a string or empty
     ///         string ("") if property doesn't exists
@@ -126,7 +168,7 @@ public:
     /// @return std::map<std::string,std::string> property values
     ///
     /// Method transforms all properties (physical and inventory) to
-    /// map. Numeric values are converted to strings using itof() method.
+    /// map. Numeric values are formatted with the decimals NUT sent.
     std::map<std::string, std::string> properties() const;
 
     /// Forgot all physics and inventory data
@@ -159,7 +201,7 @@ public:
     /// get the daisy-chain index
     int daisyChainIndex() const
     {
-        return _asset ? _asset->daisychain() : 0;
+        return _daisyChain;
     }
 
     /// get max_current as configured in the asset or NAN
@@ -180,61 +222,59 @@ private:
     /// the respective asset element, if known (owned by the state manager)
     const AssetState::Asset* _asset;
 
-    /// Updates physical or measurement value (like current or load) from float.
+    /// daisy-chain index of the asset, kept to compare with the next state
+    int _daisyChain = 0;
+
+    /// Updates physical or measurement value (like current or load).
     ///
-    /// Updates the value if new value is significantly differen (> threshold%). Flag _change is
-    /// set if new value is saved.
-    void updatePhysics(const std::string& varName, const std::string& newValue);
+    /// Updates the value if new value is out of the deadband of the quantity
+    /// (any numeric difference by default). Flag _change is set if new value is saved.
+    void updatePhysics(NameId varName, std::string_view newValue, const DeadbandRules& deadbands);
 
     /// Updates inventory value.
     ///
     /// Updates the value with values from vector. Flag _change is
     /// set if new value is different from old one.
-    void updateInventory(const std::string& varName, const std::string& inventory);
+    bool updateInventory(NameId varName, std::string_view inventory);
 
     /// Updates all values from NUT.
-    void update(std::map<std::string, std::vector<std::string>>               vars,
-        std::function<const std::map<std::string, std::string>&(const char*)> mapping, bool forceUpdate = false);
-
-    /// Set variable dst with value from src if dst not present and src is
-    ///
-    /// This method is used to normalize the NUT output from different drivers/devices.
-    void NUTSetIfNotPresent(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars,
-        const std::string& dst, const std::string& src);
+    void update(const NutVarTable& nutVars, const NutMapping& mapping, const DeadbandRules& deadbands,
+        bool forceUpdate = false);
 
-    /// Commit chages for changed calculated by updatePhysics.
-    void commitChanges();
+    /// Updates inventory values mapped from the few variables read by the
+    /// status lane (ups.status, ...). @return true if some value has changed
+    bool updateStatus(const NutVarTable& nutVars, const NutMapping& mapping);
 
     /// prefix of device in daisy chain
     ///
     /// @return std::string result is "" or device.X. where X if index in chain
-    std::string daisyPrefix() const;
+    const std::string& daisyPrefix() const;
 
-    /// map of physical values.
+    /// rebuilds _families if the set of names has changed
+    void indexFamilies();
+
+    /// physical values, by interned 42ity name
     ///
-    /// Values are multiplied by 100 and stored as integer
-    std::map<std::string, NUTPhysicalValue> _physics;
+    /// Numbers are stored as fixed-point integers
+    NutPhysicsStore _physics;
 
-    /// map of inventory values
-    std::map<std::string, NUTInventoryValue> _inventory;
+    /// inventory values, by interned 42ity name
+    NutValueStore _inventory;
 
     /// device name in nut
     std::string _nutName;
 
-    /// Transformation of our integer (x100) back
-    std::string itof(const long int) const;
-
-    /// calculate ups.load if not present
-    void NUTFixMissingLoad(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars);
-
-    /// calculate ups.realpower from output.Lx.realpower if not present
-    void NUTRealpowerFromOutput(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars);
-
-    /// NUT values transformation function
-    void NUTValuesTransformation(const std::string& prefix, std::map<std::string, std::vector<std::string>>& vars);
+    /// derived values (phases, realpower, load), resolved per set of variables
+    NutDerivation _derivation;
 
     /// last succesfull communication timestamp
     time_t _lastUpdate = 0;
+
+    /// elements of the indexed families of the values, by family
+    std::unordered_map<NameId, std::vector<NameId>> _families;
+
+    /// number of names _families has been built from
+    size_t _indexedNames = 0;
 };
 
 /// NUTDeviceList is class for holding list of NUTDevice objects.
@@ -253,6 +293,13 @@ public:
     /// Returns requested mapping
     const std::map<std::string, std::string>& get_mapping(const char* mapping) const;
 
+    /// Sets change thresholds of measurements, see DeadbandRules.
+    void setDeadbands(const DeadbandRules& deadbands);
+
+    /// indexes of the mappings compiled in NutMapping
+    static constexpr uint32_t PHYSICS_MAPPING   = 0;
+    static constexpr uint32_t INVENTORY_MAPPING = 1;
+
     /// Reads status information from NUT daemon.
     ///
     /// Method reads values from NUT and updates information of particular
@@ -260,9 +307,27 @@ public:
     /// are also removed from list.
     void update(bool forceUpdate = false);
 
+    /// Reads only the devices read from the given NUT devices (see
+    /// PollScheduler), the snapshot keeps the last values of the others.
+    /// @return names of the updated devices, none if NUT is not reachable
+    std::vector<std::string> update(const std::vector<std::string>& nutNames, bool forceUpdate = false);
+
+    /// Reads only the status variables (NUT_STATUS_VARIABLES) of all devices,
+    /// with one pipelined batch of GET VAR.
+    ///
+    /// Meant to be called often between the full updates, to report power
+    /// events early. @return names of the devices whose status has changed
+    std::vector<std::string> updateStatus();
+
+    /// NUT variables read by updateStatus()
+    static const std::vector<std::string> NUT_STATUS_VARIABLES;
+
     /// Returns true if there is at least one device claiming change.
     bool changed() const;
 
+    /// Names of the devices claiming change, proportional to their number.
+    const std::set<std::string>& changedDevices() const;
+
     /// returns the size of device list (number of devices)
     size_t size() const;
 
@@ -272,29 +337,75 @@ public:
     /// get the iterators, to be able to go trough list of devices
     std::map<std::string, NUTDevice>::iterator begin();
     std::map<std::string, NUTDevice>::iterator end();
+    std::map<std::string, NUTDevice>::iterator find(const std::string& name);
 
     /// update list of NUT devices
     void updateDeviceList(const AssetState& state);
 
+    /// NUT variables read by the last update(), or nullptr before the first one
+    std::shared_ptr<const NutSnapshot> snapshot() const
+    {
+        return _snapshot;
+    }
+
+    /// Sets number of threads reading and transforming NUT devices in parallel.
+    ///
+    /// Each worker has its own session to upsd and handles its own share of
+    /// the device list, results are merged into one snapshot.
+    void setWorkers(unsigned workers);
+
+    unsigned workers() const
+    {
+        return unsigned(_connections.size());
+    }
+
+    /// Sets the upsd the workers read from, localhost:3493 by default.
+    void setServer(const std::string& host, int port);
+
+    /// time spent by the last update(), of the slowest worker
+    struct Cost
+    {
+        uint64_t fetchUs     = 0; //!< reading variables from upsd
+        uint64_t transformUs = 0; //!< mapping and deriving the values
+    };
+    const Cost& lastCost() const
+    {
+        return _lastCost;
+    }
+
+    /// statistics of the sessions to NUT daemon, summed over all workers
+    NutConnection::Stats connectionStats() const;
+
     ~NUTDeviceList();
 
 private:
     // see http://www.networkupstools.org/docs/user-manual.chunked/apcs01.html
-    std::map<std::string, std::string> _physicsMapping;   //!< physics mapping
-    std::map<std::string, std::string> _inventoryMapping; //!< inventory mapping
-    nutclient::TcpClient               nutClient;         //!< Connection to NUT daemon
-    std::map<std::string, NUTDevice>   _devices;          //!< list of NUT devices
-    bool                               _mappingLoaded = false;
+    std::map<std::string, std::string>          _physicsMapping;   //!< physics mapping
+    std::map<std::string, std::string>          _inventoryMapping; //!< inventory mapping
+    NutMapping                                  _mapping;          //!< both mappings, compiled
+    DeadbandRules                               _deadbands;        //!< change thresholds of physics
+    std::vector<std::unique_ptr<NutConnection>> _connections;      //!< one session per worker, kept across cycles
+    std::string                                 _host = "localhost"; //!< upsd of the workers
+    int                                         _port = 3493;        //!< of _host
+    std::map<std::string, NUTDevice>            _devices;          //!< list of NUT devices
+    bool                                        _mappingLoaded = false;
+    std::shared_ptr<const NutSnapshot>          _snapshot;         //!< variables read in the last cycle
+    mutable std::set<std::string>               _changed;          //!< devices changed by update(), maybe since flagged back
+    uint64_t                                    _generation = 0;   //!< number of cycles
+    Cost                                        _lastCost;         //!< of the last update
 
 private:
-    /// connect to NUT daemon
-    bool connect();
-
-    /// disconnect from NUT daemon
-    void disconnect();
+    /// update status of given NUT devices, with all workers
+    /// @return number of updated devices or -1 if NUT is not reachable
+    int updateDeviceStatus(const std::vector<NUTDevice*>& devices, bool forceUpdate = false);
 
-    /// update status of NUT devices
-    void updateDeviceStatus(bool forceUpdate = false);
+    /// Reads variables of `devices` over `connection` into `data` and updates them,
+    /// names of the devices which have changed go to `changed`.
+    ///
+    /// Runs in a worker thread, touches only the given devices.
+    /// @return number of updated devices or -1 if NUT is not reachable
+    int updateShard(NutConnection& connection, const std::vector<NUTDevice*>& devices,
+        NutSnapshot::DevicesVars& data, std::vector<std::string>& changed, Cost& cost, bool forceUpdate);
 };
 
 
@@ -0,0 +1,264 @@
+/*  =========================================================================
+    nut_inventory - publication of inventories
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_inventory.h"
+#include <fty_log.h>
+#include <fty_proto.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+InventoryDigests NutDigests;
+
+/// FNV-1a
+static uint64_t s_hash(std::string_view text, uint64_t hash = 14695981039346656037u)
+{
+    for (char c : text) {
+        hash ^= uint8_t(c);
+        hash *= 1099511628211u;
+    }
+    return hash;
+}
+
+std::string inventoryTopic(const std::string& assetName)
+{
+    return "inventory@" + assetName;
+}
+
+zmsg_t* encodeInventory(const std::string& assetName, zhash_t** inventory)
+{
+    // same message as fty_proto_encode_asset(), which duplicates the hash first
+    fty_proto_t* proto = fty_proto_new(FTY_PROTO_ASSET);
+    if (!proto) {
+        zhash_destroy(inventory);
+        return nullptr;
+    }
+    fty_proto_set_name(proto, "%s", assetName.c_str());
+    fty_proto_set_operation(proto, "%s", "inventory");
+    fty_proto_set_ext(proto, inventory);
+    return fty_proto_encode(&proto);
+}
+
+uint64_t inventoryOffset(std::string_view assetName, uint64_t period)
+{
+    return period ? s_hash(assetName) % period : 0;
+}
+
+bool inventoryDue(std::string_view assetName, uint64_t last, uint64_t now, uint64_t period)
+{
+    if (last == 0 || period == 0) {
+        return true;
+    }
+    // number of the period, which starts at the deadline of the asset
+    uint64_t offset = inventoryOffset(assetName, period);
+    auto     round  = [&](uint64_t time) {
+        return (time + period - offset) / period;
+    };
+    return round(now) != round(last);
+}
+
+void InventoryDigest::add(std::string_view key, std::string_view value)
+{
+    // the key and its value are mixed before being summed, so that items
+    // can be added in any order
+    uint64_t hash = s_hash(value, s_hash(std::string_view("\0", 1), s_hash(key)));
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdu;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53u;
+    hash ^= hash >> 33;
+    _value += hash;
+}
+
+// "fnutdig1", the layout of the file
+static constexpr uint64_t DIGESTS_MAGIC    = 0x666e757464696731u;
+static constexpr uint32_t DIGESTS_CAPACITY = 64; //!< initial number of entries
+
+struct InventoryDigests::Header
+{
+    uint64_t magic;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+InventoryDigests::~InventoryDigests()
+{
+    close();
+}
+
+InventoryDigests::Header* InventoryDigests::header() const
+{
+    if (_mapping) {
+        return static_cast<Header*>(_mapping);
+    }
+    return _memory.empty() ? nullptr : reinterpret_cast<Header*>(const_cast<uint64_t*>(_memory.data()));
+}
+
+InventoryDigests::Entry* InventoryDigests::entries() const
+{
+    return reinterpret_cast<Entry*>(header() + 1);
+}
+
+bool InventoryDigests::reserve(uint32_t capacity)
+{
+    static_assert(sizeof(Header) == 16 && sizeof(Entry) == 16, "the memory is made of words");
+
+    size_t size = sizeof(Header) + size_t(capacity) * sizeof(Entry);
+    if (_fd < 0) {
+        _memory.resize(size / sizeof(uint64_t), 0);
+    } else {
+        if (ftruncate(_fd, off_t(size)) != 0) {
+            log_error("Cannot resize inventory digests to %zu bytes: %s", size, strerror(errno));
+            return false;
+        }
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+        if (mapping == MAP_FAILED) {
+            log_error("Cannot map inventory digests: %s", strerror(errno));
+            return false;
+        }
+        if (_mapping) {
+            munmap(_mapping, _size);
+        }
+        _mapping = mapping;
+        _size    = size;
+    }
+    header()->capacity = capacity;
+    return true;
+}
+
+void InventoryDigests::unmap()
+{
+    if (_mapping) {
+        munmap(_mapping, _size);
+        _mapping = nullptr;
+        _size    = 0;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _memory.clear();
+    _index.clear();
+}
+
+bool InventoryDigests::open(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    unmap();
+
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    struct stat st;
+    if (_fd < 0 || fstat(_fd, &st) != 0) {
+        log_error("Cannot open inventory digests %s: %s", path.c_str(), strerror(errno));
+        unmap();
+        return false;
+    }
+
+    // a file of another layout, or cut short, is started again
+    size_t size  = size_t(st.st_size);
+    bool   valid = size > sizeof(Header) && (size - sizeof(Header)) % sizeof(Entry) == 0 &&
+                 reserve(uint32_t((size - sizeof(Header)) / sizeof(Entry)));
+    if (valid) {
+        valid = header()->magic == DIGESTS_MAGIC && header()->count <= header()->capacity;
+    }
+    if (!valid) {
+        if (ftruncate(_fd, 0) != 0 || !reserve(DIGESTS_CAPACITY)) {
+            log_error("Cannot initialize inventory digests %s", path.c_str());
+            unmap();
+            return false;
+        }
+        header()->magic = DIGESTS_MAGIC;
+        header()->count = 0;
+    }
+
+    for (uint32_t i = 0; i < header()->count; i++) {
+        _index[entries()[i].asset] = i;
+    }
+    log_info("Loaded %u inventory digests from %s", header()->count, path.c_str());
+    return true;
+}
+
+void InventoryDigests::close()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    unmap();
+}
+
+std::optional<uint64_t> InventoryDigests::get(std::string_view assetName) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _index.find(s_hash(assetName));
+    if (it == _index.end()) {
+        return std::nullopt;
+    }
+    return entries()[it->second].digest;
+}
+
+void InventoryDigests::set(std::string_view assetName, uint64_t digest)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint64_t asset = s_hash(assetName);
+    auto     it    = _index.find(asset);
+    if (it != _index.end()) {
+        entries()[it->second].digest = digest;
+        return;
+    }
+    if (!header() || header()->count == header()->capacity) {
+        if (!reserve(header() ? header()->capacity * 2 : DIGESTS_CAPACITY)) {
+            return;
+        }
+    }
+    // the entry is complete before it is counted
+    uint32_t index   = header()->count;
+    entries()[index] = Entry{asset, digest};
+    header()->count  = index + 1;
+    _index[asset]    = index;
+}
+
+void InventoryDigests::erase(std::string_view assetName)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    auto it = _index.find(s_hash(assetName));
+    if (it == _index.end()) {
+        return;
+    }
+    // the last entry takes the place of the erased one
+    uint32_t index = it->second;
+    uint32_t last  = header()->count - 1;
+    _index.erase(it);
+    if (index != last) {
+        entries()[index]               = entries()[last];
+        _index[entries()[index].asset] = index;
+    }
+    header()->count = last;
+}
+
+size_t InventoryDigests::size() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _index.size();
+}
@@ -0,0 +1,121 @@
+/*  =========================================================================
+    nut_inventory - publication of inventories
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <czmq.h>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#define NUT_INVENTORY_DIGESTS "/var/lib/fty/fty-nut/inventory.digests"
+
+/// Topic of the inventory messages of an asset, "inventory@<asset>"
+std::string inventoryTopic(const std::string& assetName);
+
+/// Encodes the inventory of an asset, the fty_proto asset message with
+/// the "inventory" operation, without copying the hash again.
+///
+/// Takes the ownership of `inventory`. Values are not freed with it when it
+/// is not autofree, they only have to outlive the call.
+/// @return the message or NULL on failure
+zmsg_t* encodeInventory(const std::string& assetName, zhash_t** inventory);
+
+/// Offset [ms] of the whole inventory of an asset in the repeat `period`.
+///
+/// From a hash of the asset name, so that a fleet is not re-advertised in one
+/// burst and each asset keeps its deadline after a restart.
+uint64_t inventoryOffset(std::string_view assetName, uint64_t period);
+
+/// Whether the whole inventory of an asset is due, because it was never
+/// advertised (`last` is 0) or a deadline of the asset passed since `last`.
+/// Deadlines are at `inventoryOffset()` in each period of wall clock [ms].
+bool inventoryDue(std::string_view assetName, uint64_t last, uint64_t now, uint64_t period);
+
+/// Digest of a whole inventory, the same whatever the order of its items
+/// and from one run or build to another.
+class InventoryDigest
+{
+public:
+    void add(std::string_view key, std::string_view value);
+
+    uint64_t value() const
+    {
+        return _value;
+    }
+
+private:
+    uint64_t _value = 0;
+};
+
+/// Digests of the last published inventory of each asset, power devices and
+/// sensors, so that an inventory which did not change is not sent again after
+/// a restart.
+///
+/// Once open(), the digests live in a memory mapped file: a header and an
+/// array of (hash of the asset name, digest) pairs, 16 bytes per asset.
+/// Changes reach the file without any write call. Without a file, or if it
+/// cannot be used, the digests are kept in memory only. Thread safe.
+class InventoryDigests
+{
+public:
+    InventoryDigests() = default;
+    ~InventoryDigests();
+    InventoryDigests(const InventoryDigests&) = delete;
+    InventoryDigests& operator=(const InventoryDigests&) = delete;
+
+    /// maps the file, created if missing, the digests known so far are dropped
+    /// @return false if the file cannot be used
+    bool open(const std::string& path);
+    void close();
+
+    std::optional<uint64_t> get(std::string_view assetName) const;
+    void                    set(std::string_view assetName, uint64_t digest);
+    void                    erase(std::string_view assetName);
+    size_t                  size() const;
+
+private:
+    struct Header;
+    struct Entry
+    {
+        uint64_t asset;
+        uint64_t digest;
+    };
+
+    /// room for `capacity` entries, the mapping or the memory may move
+    bool    reserve(uint32_t capacity);
+    void    unmap();
+    Header* header() const;
+    Entry*  entries() const;
+
+    mutable std::mutex                     _mutex;
+    int                                    _fd      = -1;
+    void*                                  _mapping = nullptr; //!< of the file, if open
+    size_t                                 _size    = 0;       //!< of the mapping
+    std::vector<uint64_t>                  _memory;            //!< without a file, same layout
+    std::unordered_map<uint64_t, uint32_t> _index;             //!< asset -> entry
+};
+
+extern InventoryDigests NutDigests;
@@ -0,0 +1,184 @@
+/*  =========================================================================
+    nut_key - structured form of indexed variable names
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_key.h"
+#include <algorithm>
+#include <mutex>
+
+NutKeyTable NutKeys;
+
+/// decimal number of up to 9 digits
+static bool s_number(std::string_view text, uint32_t& value)
+{
+    if (text.empty() || text.size() > 9) {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + uint32_t(c - '0');
+    }
+    return true;
+}
+
+/// "L1" or "L1-N", the number goes to `index`
+static bool s_phase(std::string_view token, uint32_t& index)
+{
+    if (token.size() < 2 || token[0] != 'L') {
+        return false;
+    }
+    token.remove_prefix(1);
+    size_t dash = token.find('-');
+    if (dash != std::string_view::npos && token.substr(dash) != "-N") {
+        return false;
+    }
+    return s_number(token.substr(0, dash), index);
+}
+
+NutKey NutKey::parse(std::string_view name)
+{
+    NutKey key;
+
+    // daisy-chain device
+    static constexpr std::string_view DEVICE = "device.";
+    if (name.substr(0, DEVICE.size()) == DEVICE) {
+        size_t   dot = name.find('.', DEVICE.size());
+        uint32_t device;
+        if (dot != std::string_view::npos && s_number(name.substr(DEVICE.size(), dot - DEVICE.size()), device)) {
+            key.device = device;
+            name.remove_prefix(dot + 1);
+        }
+    }
+
+    // the first indexed element, its index becomes '#' in the family
+    std::string      family;
+    std::string_view previous, beforePrevious;
+    size_t           start = 0;
+    while (true) {
+        size_t           end   = name.find('.', start);
+        std::string_view token = name.substr(start, end == std::string_view::npos ? end : end - start);
+        if (start) {
+            family += '.';
+        }
+        uint32_t   index;
+        Collection collection = Collection::None;
+        if (key.collection == Collection::None && s_number(token, index)) {
+            if (previous == "outlet") {
+                collection = Collection::Outlet;
+            } else if (previous == "group" && beforePrevious == "outlet") {
+                collection = Collection::OutletGroup;
+            } else if (previous == "ambient") {
+                collection = Collection::Ambient;
+            }
+        } else if (key.collection == Collection::None && s_phase(token, index)) {
+            collection = Collection::Phase;
+        }
+        if (collection == Collection::Phase) {
+            // "L1-N" -> "L#-N"
+            family += "L#";
+            family += token.substr(std::min(token.find_first_not_of("0123456789", 1), token.size()));
+        } else if (collection != Collection::None) {
+            family += '#';
+        } else {
+            family += token;
+        }
+        if (collection != Collection::None) {
+            key.collection = collection;
+            key.index      = index;
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        beforePrevious = previous;
+        previous       = token;
+        start          = end + 1;
+    }
+    key.family = NutNames.id(family);
+    return key;
+}
+
+NutKey NutKeyTable::key(NameId name)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        if (name < _parsed.size() && _parsed[name]) {
+            return _keys[name];
+        }
+    }
+    NutKey key = NutKey::parse(NutNames.name(name));
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    if (name >= _keys.size()) {
+        _keys.resize(name + 1);
+        _parsed.resize(name + 1, false);
+    }
+    _keys[name]   = key;
+    _parsed[name] = true;
+    return key;
+}
+
+NameId NutKeyTable::name(NameId family, uint32_t index, uint32_t device)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto                                it = _names.find({family, device});
+        if (it != _names.end() && index < it->second.size() && it->second[index]) {
+            return it->second[index];
+        }
+    }
+    std::string        name     = prefix(device);
+    const std::string& pattern  = NutNames.name(family);
+    size_t             position = pattern.find('#');
+    if (position == std::string::npos) {
+        name += pattern;
+    } else {
+        name.append(pattern, 0, position);
+        name += std::to_string(index);
+        name.append(pattern, position + 1);
+    }
+    NameId id = NutNames.id(name);
+
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    auto&                               names = _names[{family, device}];
+    if (index >= names.size()) {
+        names.resize(index + 1, 0);
+    }
+    names[index] = id;
+    return id;
+}
+
+const std::string& NutKeyTable::prefix(uint32_t device)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        if (device < _prefixes.size()) {
+            return _prefixes[device];
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    while (_prefixes.size() <= device) {
+        size_t next = _prefixes.size();
+        _prefixes.push_back(next ? "device." + std::to_string(next) + "." : std::string());
+    }
+    return _prefixes[device];
+}
@@ -0,0 +1,91 @@
+/*  =========================================================================
+    nut_key - structured form of indexed variable names
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "name_interner.h"
+#include <deque>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/// Structured form of a NUT or 42ity variable name.
+///
+/// Names of outlets, outlet groups, phases and ambient sensors differ only by
+/// their indexes. A key splits a name into its daisy-chain device, the indexed
+/// collection with the element index, and the family: the name without the
+/// device prefix, with '#' for the element index as in mapping.conf.
+///
+///     "device.2.outlet.12.realpower" -> device 2, Outlet 12, "outlet.#.realpower"
+///     "realpower.outlet.12"          -> device 0, Outlet 12, "realpower.outlet.#"
+///     "current.outlet.group.3"       -> device 0, OutletGroup 3, "current.outlet.group.#"
+///     "input.L2-N.voltage"           -> device 0, Phase 2, "input.L#-N.voltage"
+///     "ambient.1.humidity.status"    -> device 0, Ambient 1, "ambient.#.humidity.status"
+///     "ups.realpower"                -> device 0, None, "ups.realpower"
+struct NutKey
+{
+    enum class Collection : uint8_t
+    {
+        None,
+        Outlet,
+        OutletGroup,
+        Phase,
+        Ambient,
+    };
+
+    uint32_t   device     = 0; //!< daisy-chain index, 0 without "device.N." prefix
+    Collection collection = Collection::None;
+    uint32_t   index      = 0; //!< element index, 0 if not indexed
+    NameId     family     = 0; //!< interned family name
+
+    /// Splits the name, interns its family.
+    static NutKey parse(std::string_view name);
+};
+
+/// Keys of interned names and names of keys, each one computed once.
+///
+/// Walking the outlets of a device needs no string formatting once their
+/// names are known, see NUTDevice::family(). Thread safe.
+class NutKeyTable
+{
+public:
+    /// key of an interned name
+    NutKey key(NameId name);
+
+    /// name of element `index` of `family` on daisy-chain `device`, interned
+    NameId name(NameId family, uint32_t index, uint32_t device = 0);
+
+    /// "device.N." prefix of a daisy-chain device, empty for 0. The reference stays valid forever.
+    const std::string& prefix(uint32_t device);
+
+private:
+    mutable std::shared_mutex _mutex;
+    std::vector<NutKey>       _keys;   //!< by NameId
+    std::vector<bool>         _parsed; //!< by NameId
+    std::deque<std::string>   _prefixes;
+    /// (family, device) -> names by element index, 0 if not built yet
+    std::map<std::pair<NameId, uint32_t>, std::vector<NameId>> _names;
+};
+
+extern NutKeyTable NutKeys;
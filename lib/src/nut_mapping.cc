@@ -0,0 +1,197 @@
+/*  =========================================================================
+    nut_mapping - NUT to 42ity mappings compiled to lookup tables
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_mapping.h"
+#include <algorithm>
+#include <fty_log.h>
+#include <mutex>
+
+void NutMapping::load(std::vector<fty::nut::KeyValues> mappings)
+{
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    _mappings = std::move(mappings);
+    _tables.clear();
+}
+
+size_t NutMapping::compiled() const
+{
+    std::shared_lock<std::shared_mutex> lock(_mutex);
+    size_t                              count = 0;
+    for (const auto& table : _tables) {
+        count += table.second.targets.size();
+    }
+    return count;
+}
+
+void NutMapping::apply(const NutVarTable& vars, int daisychain, std::vector<Value>& result) const
+{
+    result.clear();
+
+    bool                contested = false;
+    std::vector<NameId> unknown;
+    auto                emit = [&result, &contested](const Targets& targets, NameId source, std::string_view value) {
+        for (const auto& target : targets) {
+            result.push_back(Value{target.mapping, target.name, value, source});
+            contested |= target.contested;
+        }
+    };
+
+    {
+        std::shared_lock<std::shared_mutex> lock(_mutex);
+        auto                                table = _tables.find(daisychain);
+        vars.forEachId([&](NameId name, std::string_view value) {
+            if (table != _tables.end()) {
+                auto targets = table->second.targets.find(name);
+                if (targets != table->second.targets.end()) {
+                    emit(targets->second, name, value);
+                    return;
+                }
+            }
+            unknown.push_back(name);
+        });
+        if (unknown.empty()) {
+            if (contested) {
+                resolve(table->second, result);
+            }
+            return;
+        }
+    }
+
+    // first time we see these names (with this daisy-chain index)
+    std::unique_lock<std::shared_mutex> lock(_mutex);
+    Table&                              table = _tables[daisychain];
+    for (NameId name : unknown) {
+        emit(compile(table, name, daisychain), name, *vars.get(name));
+    }
+    // compiling may have made values emitted above contested
+    resolve(table, result);
+}
+
+fty::nut::KeyValues NutMapping::map(uint32_t mapping, const NutVarTable& vars, int daisychain) const
+{
+    std::vector<Value> values;
+    apply(vars, daisychain, values);
+    fty::nut::KeyValues result;
+    for (const auto& value : values) {
+        if (value.mapping == mapping) {
+            result.emplace(NutNames.name(value.name), value.value);
+        }
+    }
+    return result;
+}
+
+const NutMapping::Targets& NutMapping::compile(Table& table, NameId name, int daisychain) const
+{
+    const fty::nut::KeyValues variable{{NutNames.name(name), "1"}};
+
+    Targets targets;
+    for (uint32_t mapping = 0; mapping < _mappings.size(); mapping++) {
+        try {
+            for (const auto& mapped : fty::nut::performMapping(_mappings[mapping], variable, daisychain)) {
+                targets.push_back(Target{mapping, NutNames.id(mapped.first), false});
+            }
+        } catch (std::exception& e) {
+            log_error("mapping of %s failed: %s", NutNames.name(name).c_str(), e.what());
+        }
+    }
+    auto& result = table.targets.emplace(name, std::move(targets)).first->second;
+    for (const auto& target : result) {
+        addSource(table, target.mapping, target.name, name, daisychain);
+    }
+    return result;
+}
+
+void NutMapping::addSource(Table& table, uint32_t mapping, NameId name, NameId source, int daisychain) const
+{
+    auto& sources = table.sources[{mapping, name}];
+
+    // keep the sources ordered by preference of performMapping()
+    auto position = std::find_if(sources.begin(), sources.end(), [&](NameId other) {
+        return wins(mapping, name, source, other, daisychain);
+    });
+    sources.insert(position, source);
+
+    if (sources.size() < 2) {
+        return;
+    }
+    // values of this 42ity name must be resolved by apply()
+    for (NameId other : sources) {
+        auto targets = table.targets.find(other);
+        if (targets == table.targets.end()) {
+            continue;
+        }
+        for (auto& target : targets->second) {
+            if (target.mapping == mapping && target.name == name) {
+                target.contested = true;
+            }
+        }
+    }
+}
+
+bool NutMapping::wins(uint32_t mapping, NameId name, NameId a, NameId b, int daisychain) const
+{
+    try {
+        const fty::nut::KeyValues variables{{NutNames.name(a), "a"}, {NutNames.name(b), "b"}};
+        auto mapped = fty::nut::performMapping(_mappings[mapping], variables, daisychain);
+        auto it     = mapped.find(NutNames.name(name));
+        return it != mapped.end() && it->second == "a";
+    } catch (std::exception& e) {
+        log_error("mapping of %s failed: %s", NutNames.name(name).c_str(), e.what());
+    }
+    return false;
+}
+
+void NutMapping::resolve(const Table& table, std::vector<Value>& result) const
+{
+    // (mapping, 42ity name) -> index of the preferred value found so far
+    std::map<std::pair<uint32_t, NameId>, size_t> preferred;
+    std::vector<bool>                             dropped(result.size(), false);
+
+    for (size_t i = 0; i < result.size(); i++) {
+        const std::pair<uint32_t, NameId> key{result[i].mapping, result[i].name};
+
+        auto sources = table.sources.find(key);
+        if (sources == table.sources.end() || sources->second.size() < 2) {
+            continue;
+        }
+        auto rank = [&sources](NameId source) {
+            return std::find(sources->second.begin(), sources->second.end(), source) - sources->second.begin();
+        };
+        auto best = preferred.emplace(key, i);
+        if (best.second) {
+            continue;
+        }
+        if (rank(result[i].source) < rank(result[best.first->second].source)) {
+            dropped[best.first->second] = true;
+            best.first->second          = i;
+        } else {
+            dropped[i] = true;
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < result.size(); i++) {
+        if (!dropped[i]) {
+            result[kept++] = result[i];
+        }
+    }
+    result.resize(kept);
+}
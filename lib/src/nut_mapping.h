@@ -0,0 +1,95 @@
+/*  =========================================================================
+    nut_mapping - NUT to 42ity mappings compiled to lookup tables
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "nut_var_table.h"
+#include <fty_common_nut.h>
+#include <map>
+#include <shared_mutex>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// Mappings of mapping.conf (NUT name -> 42ity name), compiled.
+///
+/// fty::nut::performMapping() interprets the whole mapping (daisy-chain
+/// prefixes, '#' templates) for every device in every cycle. NutMapping asks
+/// performMapping() about each NUT variable name only once per daisy-chain
+/// index and keeps the answer in a hash table indexed by NameId, so mapping
+/// the variables of a device is one probe per variable and gives the same
+/// values as performMapping() would.
+///
+/// Several mappings (e.g. physics and inventory) share one table, each
+/// mapped value tells the index of its mapping. Thread safe.
+class NutMapping
+{
+public:
+    struct Value
+    {
+        uint32_t         mapping; //!< index of the mapping passed to load()
+        NameId           name;    //!< 42ity name
+        std::string_view value;   //!< view of the mapped NutVarTable
+        NameId           source;  //!< NUT name
+    };
+
+    NutMapping()                  = default;
+    NutMapping(const NutMapping&) = delete;
+    NutMapping& operator=(const NutMapping&) = delete;
+
+    /// Replaces the mappings and forgets the compiled tables.
+    void load(std::vector<fty::nut::KeyValues> mappings);
+
+    /// Maps the variables of one device, `result` is cleared first.
+    void apply(const NutVarTable& vars, int daisychain, std::vector<Value>& result) const;
+
+    /// Variables of one device mapped by one mapping, like fty::nut::performMapping().
+    fty::nut::KeyValues map(uint32_t mapping, const NutVarTable& vars, int daisychain) const;
+
+    /// number of NUT names compiled so far, over all daisy-chain indexes
+    size_t compiled() const;
+
+private:
+    struct Target
+    {
+        uint32_t mapping;
+        NameId   name;
+        bool     contested; //!< more than one NUT name maps to `name`
+    };
+    typedef std::vector<Target> Targets;
+
+    struct Table
+    {
+        std::unordered_map<NameId, Targets> targets; //!< NUT name -> 42ity names
+        /// (mapping, 42ity name) -> NUT names mapped to it, the preferred one first
+        std::map<std::pair<uint32_t, NameId>, std::vector<NameId>> sources;
+    };
+
+    const Targets& compile(Table& table, NameId name, int daisychain) const;
+    void           addSource(Table& table, uint32_t mapping, NameId name, NameId source, int daisychain) const;
+    bool           wins(uint32_t mapping, NameId name, NameId a, NameId b, int daisychain) const;
+    void           resolve(const Table& table, std::vector<Value>& result) const;
+
+    mutable std::shared_mutex        _mutex;
+    std::vector<fty::nut::KeyValues> _mappings;
+    mutable std::map<int, Table>     _tables; //!< by daisy-chain index
+};
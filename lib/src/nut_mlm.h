@@ -33,6 +33,24 @@
 #define ACTOR_CONFIGURATOR_NAME    "nut-configurator"
 #define ACTOR_CONFIGURATOR_MB_NAME ACTOR_CONFIGURATOR_NAME "-mb"
 
-#define CONFIG_POLLING   "nut/polling_interval"
-#define ACTION_POLLING   "POLLING"
-#define ACTION_CONFIGURE "CONFIGURE"
+#define CONFIG_POLLING         "nut/polling_interval"
+#define CONFIG_POLLING_WORKERS "nut/polling_workers"
+#define CONFIG_DEADBANDS       "nut/deadbands"
+#define CONFIG_STATUS_POLLING  "nut/status_polling_interval"
+#define CONFIG_NOTIFY          "nut/notify_endpoint"
+#define CONFIG_DEVICE_POLLING  "nut/device_polling_intervals"
+#define CONFIG_PUBLISH         "nut/publish_interval"
+#define CONFIG_PUBLISH_MIN_MAX "nut/publish_min_max"
+#define CONFIG_INVENTORY_DIGESTS "nut/inventory_digests"
+#define ACTION_POLLING         "POLLING"
+#define ACTION_STATUS_POLLING  "STATUS_POLLING"
+#define ACTION_NOTIFY          "NOTIFY"
+#define ACTION_WORKERS         "WORKERS"
+#define ACTION_DEADBANDS       "DEADBANDS"
+#define ACTION_DEVICE_POLLING  "DEVICE_POLLING"
+#define ACTION_PUBLISH         "PUBLISH"
+#define ACTION_PUBLISH_MIN_MAX "PUBLISH_MIN_MAX"
+#define ACTION_CONFIGURE       "CONFIGURE"
+
+// upsmon notifications, sent by fty-nut-notify (NOTIFYCMD of upsmon)
+#define NUT_NOTIFY_ENDPOINT "ipc:///var/lib/fty/fty-nut/notify"
@@ -0,0 +1,171 @@
+/*  =========================================================================
+    nut_scheduler - due times of the NUT devices to poll
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_scheduler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+
+static std::string s_trim(const std::string& s)
+{
+    auto begin = s.find_first_not_of(" \t");
+    if (begin == std::string::npos) {
+        return {};
+    }
+    auto end = s.find_last_not_of(" \t");
+    return s.substr(begin, end - begin + 1);
+}
+
+PollingIntervals PollingIntervals::parse(const std::string& rules)
+{
+    PollingIntervals result;
+
+    std::istringstream input(rules);
+    std::string        rule;
+    while (std::getline(input, rule, ',')) {
+        rule = s_trim(rule);
+        if (rule.empty()) {
+            continue;
+        }
+        auto equal = rule.find('=');
+        if (equal == std::string::npos) {
+            throw std::invalid_argument("missing '=' in '" + rule + "'");
+        }
+        std::string subtype = s_trim(rule.substr(0, equal));
+        std::string seconds = s_trim(rule.substr(equal + 1));
+        if (subtype.empty()) {
+            throw std::invalid_argument("missing device class in '" + rule + "'");
+        }
+        char*  end;
+        double value = std::strtod(seconds.c_str(), &end);
+        if (seconds.empty() || *end != '\0' || !(value > 0)) {
+            throw std::invalid_argument("invalid interval in '" + rule + "'");
+        }
+        result._intervals[subtype] = uint64_t(std::llround(value * 1000));
+    }
+    return result;
+}
+
+uint64_t PollingIntervals::get(const std::string& subtype, uint64_t fallback) const
+{
+    auto it = _intervals.find(subtype);
+    return it == _intervals.end() ? fallback : it->second;
+}
+
+void PollScheduler::push(const std::string& key, uint64_t due, uint64_t version)
+{
+    _heap.push_back(Entry{due, version, key});
+    std::push_heap(_heap.begin(), _heap.end(), std::greater<Entry>());
+}
+
+void PollScheduler::prune()
+{
+    while (!_heap.empty()) {
+        const Entry& top = _heap.front();
+        auto         key = _keys.find(top.key);
+        if (key != _keys.end() && key->second.version == top.version) {
+            return;
+        }
+        std::pop_heap(_heap.begin(), _heap.end(), std::greater<Entry>());
+        _heap.pop_back();
+    }
+}
+
+void PollScheduler::assign(const std::map<std::string, uint64_t>& intervals, uint64_t now)
+{
+    // keys of each interval, to spread them over it
+    std::map<uint64_t, std::vector<const std::string*>> groups;
+    for (const auto& item : intervals) {
+        groups[std::max<uint64_t>(item.second, 1)].push_back(&item.first);
+    }
+
+    std::map<std::string, Key> keys;
+    for (const auto& group : groups) {
+        uint64_t interval = group.first;
+        size_t   count    = group.second.size();
+        for (size_t i = 0; i < count; i++) {
+            const std::string& name = *group.second[i];
+            auto               old  = _keys.find(name);
+            if (old != _keys.end() && old->second.interval == interval) {
+                keys.emplace(name, old->second);
+                continue;
+            }
+            // slot by rank within the group, so that a fresh group is evenly spread
+            uint64_t version = ++_version;
+            keys.emplace(name, Key{interval, version});
+            push(name, now + interval * i / count, version);
+        }
+    }
+    _keys.swap(keys);
+
+    // entries of removed keys are dropped lazily, unless they pile up
+    if (_heap.size() > 2 * _keys.size() + 16) {
+        std::vector<Entry> heap;
+        for (auto& entry : _heap) {
+            auto key = _keys.find(entry.key);
+            if (key != _keys.end() && key->second.version == entry.version) {
+                heap.push_back(std::move(entry));
+            }
+        }
+        std::make_heap(heap.begin(), heap.end(), std::greater<Entry>());
+        _heap.swap(heap);
+    }
+    prune();
+}
+
+std::optional<uint64_t> PollScheduler::next() const
+{
+    if (_heap.empty()) {
+        return std::nullopt;
+    }
+    return _heap.front().due;
+}
+
+std::vector<std::string> PollScheduler::due(uint64_t now)
+{
+    std::vector<std::string> result;
+    prune();
+    while (!_heap.empty() && _heap.front().due <= now) {
+        std::pop_heap(_heap.begin(), _heap.end(), std::greater<Entry>());
+        Entry entry = std::move(_heap.back());
+        _heap.pop_back();
+
+        const Key& key = _keys.at(entry.key);
+        // keep the slot, unless we are late by more than one interval
+        uint64_t next = entry.due + key.interval;
+        if (next <= now) {
+            next = now + key.interval;
+        }
+        result.push_back(entry.key);
+        push(entry.key, next, entry.version);
+        prune();
+    }
+    return result;
+}
+
+uint64_t PollScheduler::interval(const std::string& key) const
+{
+    auto it = _keys.find(key);
+    return it == _keys.end() ? 0 : it->second.interval;
+}
@@ -0,0 +1,110 @@
+/*  =========================================================================
+    nut_scheduler - due times of the NUT devices to poll
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Polling intervals by device class (asset subtype), like "ups=10,epdu=60,sts=30"
+/// (in seconds). Classes not listed use the global polling interval.
+class PollingIntervals
+{
+public:
+    /// Parses comma separated `subtype=seconds` rules.
+    /// Throws std::invalid_argument on a malformed rule.
+    static PollingIntervals parse(const std::string& rules);
+
+    /// interval of the subtype in ms, `fallback` if not configured
+    uint64_t get(const std::string& subtype, uint64_t fallback) const;
+
+    bool empty() const
+    {
+        return _intervals.empty();
+    }
+
+private:
+    std::map<std::string, uint64_t> _intervals; //!< subtype -> [ms]
+};
+
+/// Each polled key (NUT device) has its own interval and next due time, kept
+/// in a min-heap. Keys with the same interval are spread evenly over it, so
+/// that upsd and the bus get a steady trickle of requests instead of one
+/// burst per cycle.
+///
+///     scheduler.assign({{"ups-1", 10000}, {"epdu-1", 60000}}, now);
+///     ... wait until scheduler.next() ...
+///     for (const auto& key : scheduler.due(now)) { poll(key); }
+class PollScheduler
+{
+public:
+    /// Sets the keys to poll and their intervals in ms, drops the others.
+    ///
+    /// Keys already scheduled with the same interval keep their due time, new
+    /// (or re-timed) keys get a slot within their interval starting at `now`.
+    void assign(const std::map<std::string, uint64_t>& intervals, uint64_t now);
+
+    /// due time of the earliest key, nothing if there are no keys
+    std::optional<uint64_t> next() const;
+
+    /// Removes the keys due at `now` and schedules them one interval later.
+    /// @return the due keys, the most overdue first
+    std::vector<std::string> due(uint64_t now);
+
+    /// interval of the key in ms, 0 if the key is not scheduled
+    uint64_t interval(const std::string& key) const;
+
+    size_t size() const
+    {
+        return _keys.size();
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t    due;
+        uint64_t    version; //!< outdated if different from the one of the key
+        std::string key;
+
+        bool operator>(const Entry& other) const
+        {
+            return due > other.due;
+        }
+    };
+
+    struct Key
+    {
+        uint64_t interval;
+        uint64_t version;
+    };
+
+    void push(const std::string& key, uint64_t due, uint64_t version);
+
+    /// drops outdated entries from the top of the heap
+    void prune();
+
+    std::vector<Entry>         _heap; //!< min-heap on due time, may hold outdated entries
+    std::map<std::string, Key> _keys;
+    uint64_t                   _version = 0;
+};
@@ -0,0 +1,153 @@
+/*  =========================================================================
+    nut_shm_batch - metrics of one asset collected for fty-shm
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_shm_batch.h"
+#include <algorithm>
+#include <fty_log.h>
+#include <fty_shm.h>
+
+static const std::string s_noUnit;
+
+ShmBatch::ShmBatch(const std::map<std::string, std::string>& units, Writer writer)
+    : _units(units)
+    , _writer(std::move(writer))
+{
+    if (!_writer) {
+        _writer = [](const std::string& asset, const std::string& quantity, const std::string& value,
+                      const std::string& unit, int ttl) {
+            return fty::shm::write_metric(asset, quantity, value, unit, ttl);
+        };
+    }
+}
+
+void ShmBatch::begin(const std::string& asset, int ttl, uint64_t now, uint64_t refresh)
+{
+    _asset   = asset;
+    _ttl     = ttl;
+    _now     = now;
+    _refresh = refresh;
+    _written = &_assets[asset];
+    _size    = 0;
+    _batch++;
+}
+
+void ShmBatch::forget(const std::string& asset)
+{
+    _assets.erase(asset);
+    if (asset == _asset) {
+        _written = nullptr;
+    }
+}
+
+/// pre-check of what has been written, equal hashes are confirmed on the values
+static size_t s_hash(std::string_view value, std::string_view unit, int ttl)
+{
+    size_t hash = std::hash<std::string_view>()(value);
+    hash ^= std::hash<std::string_view>()(unit) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<int>()(ttl) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+ShmBatch::Name& ShmBatch::nameOf(NameId quantity)
+{
+    if (quantity >= _names.size()) {
+        _names.resize(quantity + 1);
+    }
+    Name& name = _names[quantity];
+    if (!name.unit) {
+        const std::string& text = NutNames.name(quantity);
+        auto               unit = _units.find(text.substr(0, text.find('.')));
+        name.unit               = unit == _units.end() ? &s_noUnit : &unit->second;
+    }
+    return name;
+}
+
+void ShmBatch::add(NameId quantity, std::string_view value)
+{
+    add(quantity, value, *nameOf(quantity).unit);
+}
+
+void ShmBatch::add(NameId quantity, std::string_view value, const std::string& unit, int ttl)
+{
+    Name& name = nameOf(quantity);
+    // a metric added again replaces the previous value
+    if (name.batch != _batch) {
+        name.batch    = _batch;
+        name.position = _size++;
+        if (name.position == _entries.size()) {
+            _entries.emplace_back();
+        }
+    }
+    Entry& entry   = _entries[name.position];
+    entry.quantity = quantity;
+    entry.value.assign(value);
+    entry.unit.assign(unit);
+    entry.ttl = ttl ? ttl : _ttl;
+}
+
+size_t ShmBatch::commit()
+{
+    size_t      failures = 0;
+    size_t      skipped  = 0;
+    std::string failed;
+    for (size_t i = 0; i < _size; i++) {
+        const Entry& entry = _entries[i];
+        size_t       hash  = s_hash(entry.value, entry.unit, entry.ttl);
+        if (_written) {
+            // a different hash is a change for sure, an equal one is checked in full
+            auto written = _written->find(entry.quantity);
+            if (written != _written->end() && written->second.hash == hash && written->second.ttl == entry.ttl &&
+                written->second.value == entry.value && written->second.unit == entry.unit &&
+                written->second.expires > _now + std::min(_refresh, std::numeric_limits<uint64_t>::max() - _now)) {
+                skipped++;
+                continue;
+            }
+        }
+        const std::string& quantity = NutNames.name(entry.quantity);
+        if (_writer(_asset, quantity, entry.value, entry.unit, entry.ttl) != 0) {
+            failures++;
+            failed += (failed.empty() ? "" : ", ") + quantity;
+            if (_written) {
+                _written->erase(entry.quantity);
+            }
+            continue;
+        }
+        if (_written) {
+            // buffers of the previous write are reused
+            Written& written = (*_written)[entry.quantity];
+            written.expires  = _now + uint64_t(entry.ttl) * 1000;
+            written.hash     = hash;
+            written.value.assign(entry.value);
+            written.unit.assign(entry.unit);
+            written.ttl = entry.ttl;
+        }
+    }
+    if (failures) {
+        log_error("failed to write %zu of %zu metrics of %s: %s", failures, _size, _asset.c_str(), failed.c_str());
+    }
+    _stats.batches++;
+    _stats.metrics += _size - failures - skipped;
+    _stats.failures += failures;
+    _stats.skipped += skipped;
+    _size = 0;
+    _batch++;
+    return failures;
+}
@@ -0,0 +1,143 @@
+/*  =========================================================================
+    nut_shm_batch - metrics of one asset collected for fty-shm
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "name_interner.h"
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Collects the metrics of one asset and writes them on commit().
+///
+/// fty-shm has no batch API: each metric is its own write_metric() call,
+/// with its own file, and commit() makes one call per metric. What the batch
+/// adds is failures reported once per asset instead of once per metric. On
+/// the way, the unit of a quantity is resolved once per name, value buffers
+/// are reused, and a metric added twice is written once.
+///
+/// Metrics are written when their value changes. An unchanged metric is
+/// written again only when it would expire before the next batch of its
+/// asset, as given to begin(), so the steady write rate follows the rate of
+/// changes rather than the number of metrics.
+///
+///     batch.begin(assetName, ttl, now, pollingInterval * 3 / 2);
+///     batch.add(NutNames.id("realpower.default"), "1200");
+///     batch.add(NutNames.id("status.outlet.1"), "42", " ");
+///     batch.commit();
+class ShmBatch
+{
+public:
+    /// writes one metric, returns 0 on success (like fty::shm::write_metric)
+    typedef std::function<int(const std::string& asset, const std::string& quantity, const std::string& value,
+        const std::string& unit, int ttl)>
+        Writer;
+
+    struct Stats
+    {
+        uint64_t batches  = 0; //!< commits
+        uint64_t metrics  = 0; //!< metrics written
+        uint64_t failures = 0; //!< metrics which failed to be written
+        uint64_t skipped  = 0; //!< unchanged metrics not written again yet
+    };
+
+    /// `units` maps the first part of a quantity ("realpower" of
+    /// "realpower.default") to its unit. Writes to fty-shm if no writer is given.
+    explicit ShmBatch(const std::map<std::string, std::string>& units, Writer writer = {});
+
+    /// Starts a batch of metrics of `asset` at `now` [ms], with `ttl` [s]
+    /// unless given otherwise. Unchanged metrics are skipped unless they
+    /// expire within `refresh` ms. The defaults write everything.
+    void begin(const std::string& asset, int ttl, uint64_t now = 0,
+        uint64_t refresh = std::numeric_limits<uint64_t>::max());
+
+    /// forgets what has been written for `asset`, the next batch writes everything
+    void forget(const std::string& asset);
+
+    /// adds a metric with the unit of its quantity
+    void add(NameId quantity, std::string_view value);
+    /// adds a metric with an explicit unit and ttl (0 for the one of the batch)
+    void add(NameId quantity, std::string_view value, const std::string& unit, int ttl = 0);
+
+    /// number of metrics in the batch
+    size_t size() const
+    {
+        return _size;
+    }
+
+    /// Writes the metrics added since begin().
+    /// @return number of metrics which failed to be written
+    size_t commit();
+
+    const Stats& stats() const
+    {
+        return _stats;
+    }
+
+private:
+    struct Entry
+    {
+        NameId      quantity;
+        std::string value;
+        std::string unit;
+        int         ttl;
+    };
+
+    /// per interned name, indexed by NameId
+    struct Name
+    {
+        const std::string* unit     = nullptr; //!< nullptr if not resolved yet
+        uint64_t           batch    = 0;       //!< last batch the name was added to
+        size_t             position = 0;       //!< index in _entries in that batch
+    };
+
+    /// last write of a metric
+    struct Written
+    {
+        uint64_t    expires = 0; //!< [ms]
+        size_t      hash    = 0; //!< of value, unit and ttl, compared first
+        std::string value;
+        std::string unit;
+        int         ttl = 0;
+    };
+    typedef std::unordered_map<NameId, Written> AssetWritten;
+
+    Name& nameOf(NameId quantity);
+
+    const std::map<std::string, std::string>&     _units;
+    Writer                                        _writer;
+    std::vector<Name>                             _names;
+    std::string                                   _asset;
+    int                                           _ttl     = 0;
+    uint64_t                                      _now     = 0;
+    uint64_t                                      _refresh = 0;
+    AssetWritten*                                 _written = nullptr; //!< of _asset
+    std::unordered_map<std::string, AssetWritten> _assets; //!< what has been written, by asset
+    uint64_t                                      _batch   = 1;
+    std::vector<Entry>                            _entries; //!< grows only, first _size are in the batch
+    size_t                                        _size    = 0;
+    Stats                                         _stats;
+};
@@ -0,0 +1,63 @@
+/*  =========================================================================
+    nut_snapshot - NUT variables of all devices, shared between actors
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_snapshot.h"
+#include <atomic>
+#include <stdexcept>
+
+NutSnapshot::NutSnapshot(DevicesVars&& devices, uint64_t generation)
+    : _devices(std::move(devices))
+    , _generation(generation)
+    , _timestamp(time(nullptr))
+{
+}
+
+const NutSnapshot::DeviceVars* NutSnapshot::device(const std::string& nutName) const
+{
+    auto it = _devices.find(nutName);
+    if (it == _devices.end()) {
+        return nullptr;
+    }
+    return it->second.get();
+}
+
+std::vector<std::string> NutSnapshot::value(const std::string& nutName, const std::string& name) const
+{
+    const DeviceVars* vars = device(nutName);
+    if (!vars) {
+        throw std::runtime_error("device " + nutName + " not available");
+    }
+    auto value = vars->get(name);
+    if (!value) {
+        throw std::runtime_error("variable " + name + " not supported by " + nutName);
+    }
+    return {std::string(*value)};
+}
+
+void NutSnapshotManager::publish(std::shared_ptr<const NutSnapshot> snapshot)
+{
+    std::atomic_store(&_current, std::move(snapshot));
+}
+
+std::shared_ptr<const NutSnapshot> NutSnapshotManager::get() const
+{
+    return std::atomic_load(&_current);
+}
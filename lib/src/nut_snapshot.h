@@ -0,0 +1,105 @@
+/*  =========================================================================
+    nut_snapshot - NUT variables of all devices, shared between actors
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+/*
+ * fty_nut_server reads the variables of all power devices from upsd once per
+ * polling cycle and publishes them as an immutable NutSnapshot. The
+ * alert_actor and the sensor_actor take the most recent snapshot instead of
+ * querying upsd on their own:
+ *
+ * Acquisition (fty_nut_server):
+ *     auto snapshot = std::make_shared<const NutSnapshot>(std::move(vars), generation);
+ *     NutSnapshots.publish(snapshot);
+ *
+ * Consumers (any thread):
+ *     auto snapshot = NutSnapshots.get();
+ *     if (snapshot) {
+ *         const NutSnapshot::DeviceVars* vars = snapshot->device("ups-1");
+ *         ...
+ *     }
+ *
+ * A snapshot is never modified after it has been published, the shared_ptr
+ * keeps it alive as long as some consumer still uses it. The variables of a
+ * device are shared as well, so a snapshot of a partial cycle takes over the
+ * tables of the devices it did not read without copying them.
+ */
+
+#include "nut_var_table.h"
+#include <ctime>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+class NutSnapshot
+{
+public:
+    /// variables of one NUT device
+    typedef NutVarTable DeviceVars;
+    /// NUT device name -> variables
+    typedef std::map<std::string, std::shared_ptr<const DeviceVars>> DevicesVars;
+
+    NutSnapshot(DevicesVars&& devices, uint64_t generation);
+
+    /// Returns variables of given NUT device or nullptr if it was not read
+    const DeviceVars* device(const std::string& nutName) const;
+
+    /// Returns value of given variable, throws std::runtime_error if the
+    /// device or the variable is missing (like nut::Client::getDeviceVariableValue)
+    std::vector<std::string> value(const std::string& nutName, const std::string& name) const;
+
+    const DevicesVars& devices() const
+    {
+        return _devices;
+    }
+
+    /// sequence number of the acquisition cycle
+    uint64_t generation() const
+    {
+        return _generation;
+    }
+
+    /// time of the acquisition
+    time_t timestamp() const
+    {
+        return _timestamp;
+    }
+
+private:
+    const DevicesVars _devices;
+    const uint64_t    _generation;
+    const time_t      _timestamp;
+};
+
+/// Holds the most recent NutSnapshot. One thread publishes, N threads read.
+class NutSnapshotManager
+{
+public:
+    void                               publish(std::shared_ptr<const NutSnapshot> snapshot);
+    std::shared_ptr<const NutSnapshot> get() const;
+
+private:
+    std::shared_ptr<const NutSnapshot> _current;
+};
+
+extern NutSnapshotManager NutSnapshots;
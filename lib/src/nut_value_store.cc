@@ -0,0 +1,317 @@
+/*  =========================================================================
+    nut_value_store - flat storage of the published values of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_value_store.h"
+#include <algorithm>
+#include <cmath>
+
+/// arenas smaller than this are not worth compacting
+static constexpr size_t COMPACT_MIN_BYTES = 4096;
+
+size_t NutValueStore::find(NameId name) const
+{
+    auto it = std::lower_bound(_names.begin(), _names.end(), name);
+    if (it == _names.end() || *it != name) {
+        return size();
+    }
+    return size_t(it - _names.begin());
+}
+
+uint32_t NutValueStore::store(std::string_view value)
+{
+    auto offset = uint32_t(_arena.size());
+    _arena.append(value);
+    _arena.push_back('\0');
+    return offset;
+}
+
+void ChangedBits::set(size_t index, bool status)
+{
+    uint64_t& bits = _bits[index / 64];
+    if (bool(bits & bit(index)) == status) {
+        return;
+    }
+    if (status) {
+        bits |= bit(index);
+        _count++;
+    } else {
+        bits &= ~bit(index);
+        _count--;
+    }
+}
+
+void ChangedBits::setAll(size_t size, bool status)
+{
+    std::fill(_bits.begin(), _bits.end(), status ? ~uint64_t(0) : 0);
+    if (status && size % 64) {
+        // keep the bits past the end clear
+        _bits.back() = bit(size) - 1;
+    }
+    _count = status ? size : 0;
+}
+
+void ChangedBits::insert(size_t index, size_t size, bool status)
+{
+    if (_bits.size() * 64 < size) {
+        _bits.push_back(0);
+    }
+    // shift the flags after index, the count stays the same
+    for (size_t i = size - 1; i > index; i--) {
+        if (get(i - 1)) {
+            _bits[i / 64] |= bit(i);
+        } else {
+            _bits[i / 64] &= ~bit(i);
+        }
+    }
+    _bits[index / 64] &= ~bit(index);
+    set(index, status);
+}
+
+bool NutValueStore::set(NameId name, std::string_view value)
+{
+    auto it    = std::lower_bound(_names.begin(), _names.end(), name);
+    auto index = size_t(it - _names.begin());
+
+    if (it == _names.end() || *it != name) {
+        // new value, the set of names is stable after the first cycle
+        _names.insert(it, name);
+        _offsets.insert(_offsets.begin() + long(index), store(value));
+        _lengths.insert(_lengths.begin() + long(index), uint32_t(value.size()));
+        _changed.insert(index, _names.size(), true);
+        return true;
+    }
+
+    std::string_view old(_arena.data() + _offsets[index], _lengths[index]);
+    if (old == value) {
+        return false;
+    }
+    if (value.size() <= old.size()) {
+        // fits in place
+        value.copy(&_arena[_offsets[index]], value.size());
+        _arena[_offsets[index] + value.size()] = '\0';
+        _garbage += old.size() - value.size();
+    } else {
+        _garbage += old.size() + 1;
+        _offsets[index] = store(value);
+    }
+    _lengths[index] = uint32_t(value.size());
+    _changed.set(index, true);
+    compact();
+    return true;
+}
+
+void NutValueStore::compact()
+{
+    if (_arena.size() < COMPACT_MIN_BYTES || _garbage * 2 < _arena.size()) {
+        return;
+    }
+    std::string arena;
+    arena.reserve(_arena.size() - _garbage);
+    for (size_t i = 0; i < _names.size(); i++) {
+        auto offset = uint32_t(arena.size());
+        arena.append(_arena, _offsets[i], _lengths[i]);
+        arena.push_back('\0');
+        _offsets[i] = offset;
+    }
+    _arena.swap(arena);
+    _garbage = 0;
+}
+
+std::optional<std::string_view> NutValueStore::get(NameId name) const
+{
+    size_t index = find(name);
+    if (index == size()) {
+        return std::nullopt;
+    }
+    return std::string_view(_arena.data() + _offsets[index], _lengths[index]);
+}
+
+bool NutValueStore::changed(NameId name) const
+{
+    size_t index = find(name);
+    return index != size() && _changed.get(index);
+}
+
+void NutValueStore::setChanged(NameId name, bool status)
+{
+    size_t index = find(name);
+    if (index != size()) {
+        _changed.set(index, status);
+    }
+}
+
+void NutValueStore::setChanged(bool status)
+{
+    _changed.setAll(size(), status);
+}
+
+void NutValueStore::clear()
+{
+    _names.clear();
+    _offsets.clear();
+    _lengths.clear();
+    _changed.clear();
+    _arena.clear();
+    _garbage = 0;
+}
+
+size_t NutPhysicsStore::find(NameId name) const
+{
+    auto it = std::lower_bound(_names.begin(), _names.end(), name);
+    if (it == _names.end() || *it != name) {
+        return size();
+    }
+    return size_t(it - _names.begin());
+}
+
+bool NutPhysicsStore::set(NameId name, std::string_view value, const DeadbandRules& rules)
+{
+    auto number = FixedPoint::parse(value);
+
+    auto it    = std::lower_bound(_names.begin(), _names.end(), name);
+    auto index = size_t(it - _names.begin());
+    if (it == _names.end() || *it != name) {
+        _names.insert(it, name);
+        _values.insert(_values.begin() + long(index), number ? *number : FixedPoint{0, TEXT});
+        _texts.insert(_texts.begin() + long(index), number ? std::string() : std::string(value));
+        _deadbands.insert(_deadbands.begin() + long(index), rules.match(NutNames.name(name)));
+        _aggregates.insert(_aggregates.begin() + long(index), Aggregate());
+        if (number) {
+            _aggregates[index].add(*number);
+        }
+        _changed.insert(index, _names.size(), true);
+        return true;
+    }
+
+    FixedPoint& stored = _values[index];
+    if (number) {
+        _aggregates[index].add(*number);
+        if (stored.decimals != TEXT && !_deadbands[index].exceeded(stored, *number)) {
+            return false;
+        }
+        stored = *number;
+        _texts[index].clear();
+    } else {
+        if (stored.decimals == TEXT && _texts[index] == value) {
+            return false;
+        }
+        stored = FixedPoint{0, TEXT};
+        _texts[index].assign(value);
+    }
+    _changed.set(index, true);
+    return true;
+}
+
+void NutPhysicsStore::deadbands(const DeadbandRules& rules)
+{
+    for (size_t i = 0; i < _names.size(); i++) {
+        _deadbands[i] = rules.match(NutNames.name(_names[i]));
+    }
+}
+
+std::string_view NutPhysicsStore::text(size_t index, char* buffer) const
+{
+    if (_values[index].decimals == TEXT) {
+        return _texts[index];
+    }
+    return std::string_view(buffer, _values[index].format(buffer));
+}
+
+std::optional<std::string> NutPhysicsStore::get(NameId name) const
+{
+    size_t index = find(name);
+    if (index == size()) {
+        return std::nullopt;
+    }
+    char buffer[FixedPoint::MAX_TEXT];
+    return std::string(text(index, buffer));
+}
+
+std::optional<FixedPoint> NutPhysicsStore::number(NameId name) const
+{
+    size_t index = find(name);
+    if (index == size() || _values[index].decimals == TEXT) {
+        return std::nullopt;
+    }
+    return _values[index];
+}
+
+bool NutPhysicsStore::changed(NameId name) const
+{
+    size_t index = find(name);
+    return index != size() && _changed.get(index);
+}
+
+void NutPhysicsStore::setChanged(NameId name, bool status)
+{
+    size_t index = find(name);
+    if (index != size()) {
+        _changed.set(index, status);
+    }
+}
+
+void NutPhysicsStore::clear()
+{
+    _names.clear();
+    _values.clear();
+    _texts.clear();
+    _deadbands.clear();
+    _aggregates.clear();
+    _changed.clear();
+}
+
+void NutPhysicsStore::Aggregate::add(const FixedPoint& sample)
+{
+    double value = sample.toDouble();
+    if (count == 0 || value < min.toDouble()) {
+        min = sample;
+    }
+    if (count == 0 || value > max.toDouble()) {
+        max = sample;
+    }
+    sum += value;
+    count++;
+    decimals = std::max(decimals, sample.decimals);
+}
+
+FixedPoint NutPhysicsStore::Aggregate::mean() const
+{
+    if (count == 0) {
+        return FixedPoint{};
+    }
+    return FixedPoint{int64_t(std::llround(sum / count * std::pow(10.0, decimals))), decimals};
+}
+
+const NutPhysicsStore::Aggregate* NutPhysicsStore::aggregate(NameId name) const
+{
+    size_t index = find(name);
+    if (index == size() || _aggregates[index].count == 0) {
+        return nullptr;
+    }
+    return &_aggregates[index];
+}
+
+void NutPhysicsStore::resetAggregates()
+{
+    for (auto& aggregate : _aggregates) {
+        aggregate = Aggregate();
+    }
+}
@@ -0,0 +1,327 @@
+/*  =========================================================================
+    nut_value_store - flat storage of the published values of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "name_interner.h"
+#include "nut_deadband.h"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Changed flags of the values of a store, with the number of set flags.
+class ChangedBits
+{
+public:
+    bool get(size_t index) const
+    {
+        return _bits[index / 64] & bit(index);
+    }
+    void set(size_t index, bool status);
+    /// all `size` flags
+    void setAll(size_t size, bool status);
+    /// inserts a flag at index, shifting the following ones
+    void insert(size_t index, size_t size, bool status);
+    size_t count() const
+    {
+        return _count;
+    }
+    void clear()
+    {
+        _bits.clear();
+        _count = 0;
+    }
+
+private:
+    static uint64_t bit(size_t index)
+    {
+        return uint64_t(1) << (index % 64);
+    }
+
+    std::vector<uint64_t> _bits;
+    size_t                _count = 0; //!< number of set bits
+};
+
+/// Values of one device (inventory) by interned 42ity name.
+///
+/// Structure of arrays: sorted names, value spans into one character arena
+/// and a bitset of changed flags. Values are stored NUL terminated, so that
+/// they can be passed to C APIs. Iterating allocates nothing.
+///
+///     for (const auto& item : store) {
+///         if (item.changed) publish(NutNames.name(item.name), item.value);
+///     }
+///
+/// Views returned by get() and the iterators are valid until the store is modified.
+class NutValueStore
+{
+public:
+    struct Item
+    {
+        NameId           name;
+        std::string_view value;
+        bool             changed;
+    };
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const NutValueStore* store, size_t index)
+            : _store(store)
+            , _index(index)
+        {
+        }
+        Item operator*() const
+        {
+            return _store->item(_index);
+        }
+        const_iterator& operator++()
+        {
+            ++_index;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return _index == other._index;
+        }
+        bool operator!=(const const_iterator& other) const
+        {
+            return _index != other._index;
+        }
+
+    private:
+        const NutValueStore* _store;
+        size_t               _index;
+    };
+
+    /// Sets the value, marks it changed if it is new or different.
+    /// @return true if the value has changed
+    bool set(NameId name, std::string_view value);
+
+    std::optional<std::string_view> get(NameId name) const;
+    std::optional<std::string_view> get(std::optional<NameId> name) const
+    {
+        return name ? get(*name) : std::nullopt;
+    }
+
+    bool has(NameId name) const
+    {
+        return bool(get(name));
+    }
+
+    /// changed flag of one value, false if there is no such value
+    bool changed(NameId name) const;
+    /// true if any value is changed, O(1)
+    bool changed() const
+    {
+        return _changed.count() != 0;
+    }
+    /// number of changed values
+    size_t changedCount() const
+    {
+        return _changed.count();
+    }
+
+    void setChanged(NameId name, bool status);
+    void setChanged(bool status);
+
+    size_t size() const
+    {
+        return _names.size();
+    }
+    bool empty() const
+    {
+        return _names.empty();
+    }
+    void clear();
+
+    Item item(size_t index) const
+    {
+        return Item{
+            _names[index], std::string_view(_arena.data() + _offsets[index], _lengths[index]), _changed.get(index)};
+    }
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+private:
+    /// position of `name` in _names, or size() if not present
+    size_t find(NameId name) const;
+
+    /// appends NUL terminated value to the arena, returns its offset
+    uint32_t store(std::string_view value);
+
+    /// drops the garbage of replaced values once it is half of the arena
+    void compact();
+
+    std::vector<NameId>   _names;   //!< sorted
+    std::vector<uint32_t> _offsets; //!< value offsets in _arena
+    std::vector<uint32_t> _lengths; //!< value lengths, without the NUL
+    ChangedBits           _changed; //!< bit i is the changed flag of _names[i]
+    std::string           _arena;
+    size_t                _garbage = 0; //!< bytes of _arena no value refers to
+};
+
+/// Measurements of one device by interned 42ity name.
+///
+/// Same layout as NutValueStore, but numbers are kept as FixedPoint and
+/// formatted only when they are read. A new value replaces the stored one
+/// only when it is out of the deadband of its quantity; text values (not a
+/// number) are compared as text.
+///
+/// Each number also feeds the running min, max and mean of its samples,
+/// deadband or not, until resetAggregates(). Those live in one fixed-size
+/// slot per name, sampling allocates nothing.
+class NutPhysicsStore
+{
+public:
+    typedef NutValueStore::Item Item;
+
+    /// numeric samples of one name since the last resetAggregates()
+    struct Aggregate
+    {
+        FixedPoint min;
+        FixedPoint max;
+        double     sum      = 0;
+        uint32_t   count    = 0;
+        uint8_t    decimals = 0; //!< most decimals of the samples
+
+        void       add(const FixedPoint& sample);
+        /// mean with the decimals of the samples
+        FixedPoint mean() const;
+    };
+
+    /// Formats the value of the current item into its own buffer.
+    class const_iterator
+    {
+    public:
+        const_iterator(const NutPhysicsStore* store, size_t index)
+            : _store(store)
+            , _index(index)
+        {
+        }
+        Item operator*() const
+        {
+            return Item{_store->_names[_index], _store->text(_index, _buffer), _store->_changed.get(_index)};
+        }
+        const_iterator& operator++()
+        {
+            ++_index;
+            return *this;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return _index == other._index;
+        }
+        bool operator!=(const const_iterator& other) const
+        {
+            return _index != other._index;
+        }
+
+    private:
+        const NutPhysicsStore* _store;
+        size_t                 _index;
+        mutable char           _buffer[FixedPoint::MAX_TEXT];
+    };
+
+    /// Sets the value if it is out of the deadband of the stored one (or
+    /// new) and marks it changed. The deadband of a new name comes from
+    /// `rules`. @return true if the value has changed
+    bool set(NameId name, std::string_view value, const DeadbandRules& rules = DeadbandRules());
+
+    /// Recomputes deadbands of the stored names.
+    void deadbands(const DeadbandRules& rules);
+
+    /// the value as it is published
+    std::optional<std::string> get(NameId name) const;
+    std::optional<std::string> get(std::optional<NameId> name) const
+    {
+        return name ? get(*name) : std::nullopt;
+    }
+    /// numeric value, nullopt if not present or not a number
+    std::optional<FixedPoint> number(NameId name) const;
+
+    /// samples of the name, nullptr if there was no number since resetAggregates()
+    const Aggregate* aggregate(NameId name) const;
+    /// starts new aggregates of all names
+    void resetAggregates();
+
+    bool has(NameId name) const
+    {
+        return find(name) != size();
+    }
+
+    bool changed(NameId name) const;
+    bool changed() const
+    {
+        return _changed.count() != 0;
+    }
+    size_t changedCount() const
+    {
+        return _changed.count();
+    }
+
+    void setChanged(NameId name, bool status);
+    void setChanged(bool status)
+    {
+        _changed.setAll(size(), status);
+    }
+
+    size_t size() const
+    {
+        return _names.size();
+    }
+    bool empty() const
+    {
+        return _names.empty();
+    }
+    void clear();
+
+    const_iterator begin() const
+    {
+        return const_iterator(this, 0);
+    }
+    const_iterator end() const
+    {
+        return const_iterator(this, size());
+    }
+
+private:
+    /// marks values which are not a number
+    static constexpr uint8_t TEXT = 0xff;
+
+    size_t           find(NameId name) const;
+    std::string_view text(size_t index, char* buffer) const;
+
+    std::vector<NameId>      _names;     //!< sorted
+    std::vector<FixedPoint>  _values;    //!< decimals == TEXT for text values
+    std::vector<std::string> _texts;     //!< text values, empty for numbers
+    std::vector<Deadband>    _deadbands;  //!< of each name
+    std::vector<Aggregate>   _aggregates; //!< of each name
+    ChangedBits              _changed;
+};
@@ -0,0 +1,171 @@
+/*  =========================================================================
+    nut_var_table - flat table of NUT variables of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "nut_var_table.h"
+#include <algorithm>
+#include <stdexcept>
+
+NutVarTable::NutVarTable(const NutVarTable* base)
+    : _base(base)
+{
+    if (_base && _base->_base) {
+        throw std::invalid_argument("NutVarTable: a layer can't be the base of another layer");
+    }
+}
+
+NutVarTable::NutVarTable(const std::map<std::string, std::vector<std::string>>& vars)
+{
+    std::string joined;
+    for (const auto& var : vars) {
+        joined.clear();
+        for (const auto& item : var.second) {
+            if (item.empty()) {
+                continue;
+            }
+            if (!joined.empty()) {
+                joined += ", ";
+            }
+            joined += item;
+        }
+        add(var.first, joined);
+    }
+    seal();
+}
+
+uint32_t NutVarTable::store(std::string_view value)
+{
+    // value may be a view of the arena, which can be reallocated below
+    if (value.data() >= _arena.data() && value.data() < _arena.data() + _arena.size()) {
+        std::string copy(value);
+        return store(copy);
+    }
+    auto offset = uint32_t(_arena.size());
+    _arena.append(value);
+    return offset;
+}
+
+void NutVarTable::reserve(size_t variables, size_t characters)
+{
+    _slots.reserve(variables);
+    _arena.reserve(characters);
+}
+
+void NutVarTable::add(NameId name, std::string_view value)
+{
+    if (_sorted && !_slots.empty() && !(_slots.back().name < name)) {
+        _sorted = false;
+    }
+    _slots.push_back(Slot{name, store(value), uint32_t(value.size())});
+    if (_sorted && (!_base || !_base->find(name))) {
+        // unique so far, otherwise seal() computes the schema
+        _schema ^= nameHash(name);
+    }
+}
+
+uint64_t NutVarTable::nameHash(NameId name)
+{
+    // splitmix64 finalizer
+    uint64_t x = name + 0x9e3779b97f4a7c15ull;
+    x          = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x          = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+void NutVarTable::seal()
+{
+    if (_sorted) {
+        return;
+    }
+    // stable, so that the last of equal names stays last
+    std::stable_sort(_slots.begin(), _slots.end(), [](const Slot& a, const Slot& b) {
+        return a.name < b.name;
+    });
+    size_t count = 0;
+    for (size_t i = 0; i < _slots.size(); i++) {
+        if (count && _slots[count - 1].name == _slots[i].name) {
+            _slots[count - 1] = _slots[i];
+        } else {
+            _slots[count++] = _slots[i];
+        }
+    }
+    _slots.resize(count);
+    _sorted = true;
+
+    _schema = 0;
+    for (const auto& slot : _slots) {
+        if (!_base || !_base->find(slot.name)) {
+            _schema ^= nameHash(slot.name);
+        }
+    }
+}
+
+const NutVarTable::Slot* NutVarTable::find(NameId name) const
+{
+    if (!_sorted) {
+        // being filled, the last one wins
+        for (auto it = _slots.rbegin(); it != _slots.rend(); ++it) {
+            if (it->name == name) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+    auto it = std::lower_bound(_slots.begin(), _slots.end(), name, [](const Slot& slot, NameId key) {
+        return slot.name < key;
+    });
+    if (it != _slots.end() && it->name == name) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+void NutVarTable::set(NameId name, std::string_view value)
+{
+    seal();
+    auto it = std::lower_bound(_slots.begin(), _slots.end(), name, [](const Slot& slot, NameId key) {
+        return slot.name < key;
+    });
+    if (it != _slots.end() && it->name == name) {
+        if (valueOf(*it) == value) {
+            return;
+        }
+        // the old value stays unused in the arena
+        it->value       = store(value);
+        it->valueLength = uint32_t(value.size());
+        return;
+    }
+    _slots.insert(it, Slot{name, store(value), uint32_t(value.size())});
+    if (!_base || !_base->find(name)) {
+        _schema ^= nameHash(name);
+    }
+}
+
+std::optional<std::string_view> NutVarTable::get(NameId name) const
+{
+    const Slot* slot = find(name);
+    if (slot) {
+        return valueOf(*slot);
+    }
+    if (_base) {
+        return _base->get(name);
+    }
+    return std::nullopt;
+}
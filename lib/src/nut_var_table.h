@@ -0,0 +1,180 @@
+/*  =========================================================================
+    nut_var_table - flat table of NUT variables of one device
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include "name_interner.h"
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Variables of one NUT device.
+///
+/// Values live in one character arena, the table itself is a vector of
+/// (NameId, offset) sorted by the interned name id. Each variable has one
+/// scalar value (upsd sends one quoted string per variable, multi-word
+/// values of nut::Client are joined with ", ").
+///
+/// A table can be layered over a constant base table: lookups see the own
+/// variables first, so derived values can be added without copying the base.
+/// Returned string_views are valid until the table is modified.
+class NutVarTable
+{
+public:
+    NutVarTable() = default;
+
+    /// Creates an empty layer over `base`, which must outlive this table.
+    /// The base is a sealed table, not a layer itself.
+    explicit NutVarTable(const NutVarTable* base);
+
+    /// Converts variables as returned by nut::Client.
+    NutVarTable(const std::map<std::string, std::vector<std::string>>& vars);
+
+    /// Appends a variable while the table is being filled. Call seal() when done.
+    void add(NameId name, std::string_view value);
+    void add(std::string_view name, std::string_view value)
+    {
+        add(NutNames.id(name), value);
+    }
+
+    /// Sorts the added variables, the last one of duplicated names wins.
+    void seal();
+
+    /// Inserts or replaces a variable of this layer.
+    void set(NameId name, std::string_view value);
+    void set(std::string_view name, std::string_view value)
+    {
+        set(NutNames.id(name), value);
+    }
+    void set(std::string_view prefix, std::string_view name, std::string_view value)
+    {
+        set(NutNames.id(prefix, name), value);
+    }
+
+    /// Value of a variable (of this layer or of the base)
+    std::optional<std::string_view> get(NameId name) const;
+    std::optional<std::string_view> get(std::optional<NameId> name) const
+    {
+        return name ? get(*name) : std::nullopt;
+    }
+    std::optional<std::string_view> get(std::string_view name) const
+    {
+        return get(NutNames.find(name));
+    }
+    std::optional<std::string_view> get(std::string_view prefix, std::string_view name) const
+    {
+        return get(NutNames.find(prefix, name));
+    }
+
+    template <typename... Name>
+    bool has(const Name&... name) const
+    {
+        return bool(get(name...));
+    }
+
+    /// true if neither this layer nor the base has any variable
+    bool empty() const
+    {
+        return _slots.empty() && (!_base || _base->empty());
+    }
+
+    /// number of variables of this layer
+    size_t size() const
+    {
+        return _slots.size();
+    }
+
+    /// Hash of the set of variable names (of this layer and the base), the
+    /// values don't matter. Valid once the table is sealed.
+    uint64_t schema() const
+    {
+        return _schema ^ (_base ? _base->_schema : 0);
+    }
+
+    /// Calls f(NameId, value) for all variables ordered by id, variables of
+    /// this layer hide those of the base.
+    template <typename F>
+    void forEachId(F&& f) const;
+
+    /// Calls f(name, value) for all variables, in the order of forEachId().
+    template <typename F>
+    void forEach(F&& f) const
+    {
+        forEachId([&f](NameId name, std::string_view value) {
+            f(std::string_view(NutNames.name(name)), value);
+        });
+    }
+
+    /// Reserves space for the expected number of variables and characters.
+    void reserve(size_t variables, size_t characters);
+
+private:
+    struct Slot
+    {
+        NameId   name;
+        uint32_t value;
+        uint32_t valueLength;
+    };
+
+    std::string_view valueOf(const Slot& slot) const
+    {
+        return std::string_view(_arena.data() + slot.value, slot.valueLength);
+    }
+    uint32_t store(std::string_view value);
+
+    /// own slot of `name` or nullptr
+    const Slot* find(NameId name) const;
+
+    /// hash of one name, schema is the xor of those
+    static uint64_t nameHash(NameId name);
+
+    const NutVarTable* _base   = nullptr;
+    std::string        _arena;
+    std::vector<Slot>  _slots;
+    bool               _sorted = true;
+    uint64_t           _schema = 0; //!< of own names not in the base
+};
+
+template <typename F>
+void NutVarTable::forEachId(F&& f) const
+{
+    auto it = _slots.begin();
+    if (_base) {
+        // merge of two sorted sequences
+        for (const auto& baseSlot : _base->_slots) {
+            for (; it != _slots.end() && it->name < baseSlot.name; ++it) {
+                f(it->name, valueOf(*it));
+            }
+            if (it != _slots.end() && it->name == baseSlot.name) {
+                f(it->name, valueOf(*it));
+                ++it;
+                continue;
+            }
+            f(baseSlot.name, _base->valueOf(baseSlot));
+        }
+    }
+    for (; it != _slots.end(); ++it) {
+        f(it->name, valueOf(*it));
+    }
+}
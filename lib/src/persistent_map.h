@@ -0,0 +1,291 @@
+/*  =========================================================================
+    persistent_map - immutable ordered map sharing its nodes between versions
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/// Ordered map whose copies share their nodes.
+///
+/// A copy costs one shared_ptr copy. A change copies only the path from the
+/// root to the changed node (an AVL tree, O(log n) nodes), the other copies
+/// keep seeing their own version. Nodes are never modified once built, so
+/// versions can be read from several threads while one of them is changed.
+///
+/// The interface is the subset of std::map used for asset states; there is
+/// no mutable access to the values, use insert_or_assign().
+template <typename Key, typename Value, typename Compare = std::less<Key>>
+class PersistentMap
+{
+    struct Node;
+    typedef std::shared_ptr<const Node> NodePtr;
+
+public:
+    typedef Key                         key_type;
+    typedef Value                       mapped_type;
+    typedef std::pair<const Key, Value> value_type;
+    typedef size_t                      size_type;
+
+    class const_iterator
+    {
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef PersistentMap::value_type value_type;
+        typedef std::ptrdiff_t            difference_type;
+        typedef const value_type*         pointer;
+        typedef const value_type&         reference;
+
+        const_iterator() = default;
+
+        reference operator*() const
+        {
+            return _path.back()->item;
+        }
+        pointer operator->() const
+        {
+            return &_path.back()->item;
+        }
+        const_iterator& operator++()
+        {
+            const Node* node = _path.back();
+            _path.pop_back();
+            descend(node->right.get());
+            return *this;
+        }
+        const_iterator operator++(int)
+        {
+            const_iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+        bool operator==(const const_iterator& other) const
+        {
+            return _path.empty() ? other._path.empty() : !other._path.empty() && _path.back() == other._path.back();
+        }
+        bool operator!=(const const_iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        /// to the smallest item of the subtree
+        void descend(const Node* node)
+        {
+            for (; node; node = node->left.get()) {
+                _path.push_back(node);
+            }
+        }
+        // nodes still to visit, the current one last
+        std::vector<const Node*> _path;
+        friend class PersistentMap;
+    };
+    typedef const_iterator iterator;
+
+    PersistentMap() = default;
+
+    bool empty() const
+    {
+        return !_root;
+    }
+    size_type size() const
+    {
+        return _size;
+    }
+
+    const_iterator begin() const
+    {
+        const_iterator it;
+        it.descend(_root.get());
+        return it;
+    }
+    const_iterator end() const
+    {
+        return const_iterator();
+    }
+    const_iterator cbegin() const
+    {
+        return begin();
+    }
+    const_iterator cend() const
+    {
+        return end();
+    }
+
+    /// first item not before `key`
+    const_iterator lower_bound(const Key& key) const
+    {
+        const_iterator it;
+        for (const Node* node = _root.get(); node;) {
+            if (_compare(node->item.first, key)) {
+                node = node->right.get();
+            } else {
+                it._path.push_back(node);
+                node = node->left.get();
+            }
+        }
+        return it;
+    }
+    const_iterator find(const Key& key) const
+    {
+        const_iterator it = lower_bound(key);
+        return it == end() || _compare(key, it->first) ? end() : it;
+    }
+    size_type count(const Key& key) const
+    {
+        return find(key) == end() ? 0 : 1;
+    }
+    const Value& at(const Key& key) const
+    {
+        const_iterator it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("PersistentMap::at");
+        }
+        return it->second;
+    }
+
+    void insert_or_assign(const Key& key, Value value)
+    {
+        bool added = false;
+        _root      = insert(_root, key, std::move(value), added);
+        _size += added;
+    }
+    size_type erase(const Key& key)
+    {
+        bool removed = false;
+        _root        = erase(_root, key, removed);
+        _size -= removed;
+        return removed;
+    }
+    void clear()
+    {
+        _root.reset();
+        _size = 0;
+    }
+
+private:
+    struct Node
+    {
+        Node(value_type item_, NodePtr left_, NodePtr right_)
+            : item(std::move(item_))
+            , left(std::move(left_))
+            , right(std::move(right_))
+            , height(1 + std::max(PersistentMap::height(left), PersistentMap::height(right)))
+        {
+        }
+        const value_type item;
+        const NodePtr    left, right;
+        const int        height;
+    };
+
+    static int height(const NodePtr& node)
+    {
+        return node ? node->height : 0;
+    }
+
+    static NodePtr make(value_type item, NodePtr left, NodePtr right)
+    {
+        return std::make_shared<const Node>(std::move(item), std::move(left), std::move(right));
+    }
+
+    /// new node, rotated if its subtrees differ by 2 in height
+    static NodePtr balance(value_type item, NodePtr left, NodePtr right)
+    {
+        if (height(left) > height(right) + 1) {
+            if (height(left->left) >= height(left->right)) {
+                return make(left->item, left->left, make(std::move(item), left->right, std::move(right)));
+            }
+            const Node* middle = left->right.get();
+            return make(middle->item, make(left->item, left->left, middle->left),
+                make(std::move(item), middle->right, std::move(right)));
+        }
+        if (height(right) > height(left) + 1) {
+            if (height(right->right) >= height(right->left)) {
+                return make(right->item, make(std::move(item), std::move(left), right->left), right->right);
+            }
+            const Node* middle = right->left.get();
+            return make(middle->item, make(std::move(item), std::move(left), middle->left),
+                make(right->item, middle->right, right->right));
+        }
+        return make(std::move(item), std::move(left), std::move(right));
+    }
+
+    NodePtr insert(const NodePtr& node, const Key& key, Value&& value, bool& added) const
+    {
+        if (!node) {
+            added = true;
+            return make(value_type(key, std::move(value)), nullptr, nullptr);
+        }
+        if (_compare(key, node->item.first)) {
+            return balance(node->item, insert(node->left, key, std::move(value), added), node->right);
+        }
+        if (_compare(node->item.first, key)) {
+            return balance(node->item, node->left, insert(node->right, key, std::move(value), added));
+        }
+        return make(value_type(key, std::move(value)), node->left, node->right);
+    }
+
+    NodePtr erase(const NodePtr& node, const Key& key, bool& removed) const
+    {
+        if (!node) {
+            return node;
+        }
+        if (_compare(key, node->item.first)) {
+            NodePtr left = erase(node->left, key, removed);
+            return removed ? balance(node->item, std::move(left), node->right) : node;
+        }
+        if (_compare(node->item.first, key)) {
+            NodePtr right = erase(node->right, key, removed);
+            return removed ? balance(node->item, node->left, std::move(right)) : node;
+        }
+        removed = true;
+        if (!node->left) {
+            return node->right;
+        }
+        if (!node->right) {
+            return node->left;
+        }
+        // the next item takes its place
+        const Node* next = node->right.get();
+        while (next->left) {
+            next = next->left.get();
+        }
+        return balance(next->item, node->left, eraseFirst(node->right));
+    }
+
+    static NodePtr eraseFirst(const NodePtr& node)
+    {
+        if (!node->left) {
+            return node->right;
+        }
+        return balance(node->item, eraseFirst(node->left), node->right);
+    }
+
+    NodePtr   _root;
+    size_type _size = 0;
+    Compare   _compare;
+};
@@ -118,15 +118,16 @@ void sensor_actor(zsock_t* pipe, void* args)
         void* which = zpoller_wait(poller, int(polling));
         if (which == NULL || zclock_mono() - publishtime > int64_t(polling)) {
             log_debug("sa: sensor update");
-            nut::TcpClient nutClient;
-            nutClient.connect("localhost", 3493);
-            sensors.updateSensorList(nutClient, client);
-            sensors.updateFromNUT(nutClient);
+            // NUT variables are read by fty_nut_server, see nut_snapshot.h
+            auto snapshot = NutSnapshots.get();
+            if (snapshot) {
+                sensors.updateSensorList(*snapshot, client);
+                sensors.updateFromNUT(*snapshot);
+            }
             sensors.advertiseInventory(client);
             // hotfix IPMVAL-2713 (data stale on device which host sensors cause communication failure alarms on
             // sensors) increase ttl from 60 to 240 sec (polling is equal to 30 sec).
             sensors.publish(client, int((polling * 8) / 1000));
-            nutClient.disconnect();
             publishtime = zclock_mono();
         } else if (which == pipe) {
             zmsg_t* msg = zmsg_recv(pipe);
@@ -23,29 +23,26 @@
 #include <fty_common_nut.h>
 #include <fty_log.h>
 #include <fty_proto.h>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
-static std::string collapse_commas(const std::vector<std::string>& values)
-{
-    std::string inventory = "";
-    for (size_t i = 0; i < values.size(); ++i) {
-        inventory += values[i];
-        if (i < values.size() - 1) {
-            inventory += ", ";
-        }
-    }
-    return inventory;
-}
-
-void Sensor::update(nut::TcpClient& conn, const std::map<std::string, std::string>& mapping)
+void Sensor::update(const NutSnapshot& snapshot, const NutMapping& mapping)
 {
     log_debug("sa: updating sensor(s) temperature and humidity from NUT device %s", _nutMaster.c_str());
-    auto nutDevice = conn.getDevice(_nutMaster);
-    if (!nutDevice.isOk()) {
+    auto deviceVars = snapshot.device(_nutMaster);
+    if (!deviceVars) {
         log_debug("sa: NUT device %s is not ready", _nutMaster.c_str());
         return;
     }
+    // throws for missing variables, like nut::Device::getVariableValue() does
+    auto getVariableValue = [&](const std::string& prefix, const std::string& name) {
+        auto value = deviceVars->get(prefix, name);
+        if (!value) {
+            throw std::runtime_error("variable " + prefix + name + " not supported by " + _nutMaster);
+        }
+        return std::vector<std::string>{std::string(*value)};
+    };
 
     try {
         std::string prefix   = nutPrefix();
@@ -53,18 +50,11 @@ void Sensor::update(nut::TcpClient& conn, const std::map<std::string, std::strin
         log_debug("sa: prefix='%s' prefixId='%d'", prefix.c_str(), prefixId);
 
         // Translate NUT keys into 42ity keys.
-        {
-            std::map<std::string, std::vector<std::string>> deviceVars = nutDevice.getVariableValues();
-            fty::nut::KeyValues                             scalarVars;
-            for (auto var : deviceVars) {
-                scalarVars.emplace(var.first, collapse_commas(var.second));
-            }
-            _inventory = fty::nut::performMapping(mapping, scalarVars, prefixId);
-        }
+        _inventory = mapping.map(0, *deviceVars, prefixId);
 
         try {
             // Check for actual sensor presence, if ambient.present is available!
-            auto sensorPresent = nutDevice.getVariableValue(prefix + "present");
+            auto sensorPresent = getVariableValue(prefix, "present");
             log_debug("sa: sensor '%s' presence: '%s'", prefix.c_str(), sensorPresent[0].c_str());
             if ((!sensorPresent.empty()) && (sensorPresent[0] != "yes")) {
                 log_debug("sa: sensor '%s' is not present or disconnected on NUT device %s", prefix.c_str(),
@@ -75,7 +65,7 @@ void Sensor::update(nut::TcpClient& conn, const std::map<std::string, std::strin
         }
 
         log_debug("sa: getting %stemperature from %s", prefix.c_str(), _nutMaster.c_str());
-        auto temperature = nutDevice.getVariableValue(prefix + "temperature");
+        auto temperature = getVariableValue(prefix, "temperature");
         if (temperature.empty()) {
             log_debug("sa: %stemperature on %s is not present", prefix.c_str(), location().c_str());
         } else {
@@ -84,7 +74,7 @@ void Sensor::update(nut::TcpClient& conn, const std::map<std::string, std::strin
         }
 
         log_debug("sa: getting %shumidity from %s", prefix.c_str(), _nutMaster.c_str());
-        auto humidity = nutDevice.getVariableValue(prefix + "humidity");
+        auto humidity = getVariableValue(prefix, "humidity");
         if (humidity.empty()) {
             log_debug("sa: %shumidity on %s is not present", prefix.c_str(), location().c_str());
         } else {
@@ -95,13 +85,13 @@ void Sensor::update(nut::TcpClient& conn, const std::map<std::string, std::strin
         _contacts.clear();
 
         for (int i = 1; i <= 2; i++) {
-            std::string baseVar = prefix + "contacts." + std::to_string(i);
-            std::string state   = nutDevice.getVariableValue(baseVar + ".status")[0];
+            std::string baseVar = "contacts." + std::to_string(i);
+            std::string state   = getVariableValue(prefix, baseVar + ".status")[0];
             if (state != "unknown" && state != "bad") {
                 // process new status style (active / inactive), found on EMP002
                 // WRT the polarity configured
                 if (state == "active" || state == "inactive") {
-                    std::string contactConfig = nutDevice.getVariableValue(baseVar + ".config")[0];
+                    std::string contactConfig = getVariableValue(prefix, baseVar + ".config")[0];
                     if (!contactConfig.empty()) {
                         if (contactConfig == "normal-opened") {
                             if (state == "active")
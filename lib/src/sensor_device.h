@@ -22,10 +22,11 @@
 #pragma once
 
 #include "asset_state.h"
+#include "nut_mapping.h"
+#include "nut_snapshot.h"
 #include <fty_common_nut.h>
 #include <malamute.h>
 #include <map>
-#include <nutclient.h>
 #include <string>
 
 class Sensor
@@ -58,7 +59,7 @@ public:
         , _nutMaster(nutMaster)
         , _index(index){};
 
-    void        update(nut::TcpClient& conn, const std::map<std::string, std::string>& mapping);
+    void        update(const NutSnapshot& snapshot, const NutMapping& mapping);
     void        publish(mlm_client_t* client, int ttl);
     void        addChild(const std::string& port, const std::string& child_name);
     ChildrenMap getChildren();
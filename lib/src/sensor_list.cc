@@ -21,6 +21,7 @@
 
 #include "sensor_list.h"
 #include "nut_agent.h"
+#include "nut_inventory.h"
 #include <fty_asset_accessor.h>
 #include <fty_common_nut.h>
 #include <fty_log.h>
@@ -32,11 +33,11 @@ Sensors::Sensors(StateManager::Reader* reader)
 }
 
 
-void Sensors::updateFromNUT(nut::TcpClient& conn)
+void Sensors::updateFromNUT(const NutSnapshot& snapshot)
 {
     try {
         for (auto& it : _sensors) {
-            it.second.update(conn, _sensorInventoryMapping);
+            it.second.update(snapshot, _sensorInventory);
         }
     } catch (std::exception& e) {
         log_error("reading data from NUT: %s", e.what());
@@ -122,7 +123,25 @@ bool Sensors::updateAssetConfig(AssetState::Asset* asset, mlm_client_t* client)
     return true;
 }
 
-void Sensors::updateSensorList (nut::Client &conn, mlm_client_t *client)
+void Sensors::updateSensorList(nut::Client& conn, mlm_client_t* client)
+{
+    updateSensorList(
+        [&conn](const std::string& device, const std::string& name) {
+            return conn.getDeviceVariableValue(device, name);
+        },
+        client);
+}
+
+void Sensors::updateSensorList(const NutSnapshot& snapshot, mlm_client_t* client)
+{
+    updateSensorList(
+        [&snapshot](const std::string& device, const std::string& name) {
+            return snapshot.value(device, name);
+        },
+        client);
+}
+
+void Sensors::updateSensorList(const VariableReader& getDeviceVariableValue, mlm_client_t* client)
 {
     // Note: force refresh sensors list if an error has been detected
     if (!_sensorListError && !_state_reader->refresh())
@@ -211,7 +230,7 @@ void Sensors::updateSensorList (nut::Client &conn, mlm_client_t *client)
                 std::string sensorCountName = prefix + std::string("ambient.count");
                 std::vector<std::string> values = {};
                 try {
-                    values = conn.getDeviceVariableValue(master, sensorCountName);
+                    values = getDeviceVariableValue(master, sensorCountName);
                 } catch (std::exception& e) {
                     log_error(
                         "Nut object %s not found for (%s): %s", sensorCountName.c_str(), master.c_str(), e.what());
@@ -226,7 +245,7 @@ void Sensors::updateSensorList (nut::Client &conn, mlm_client_t *client)
                         std::string addressDeviceName =
                             prefix + std::string("ambient.") + std::to_string(iSensor) + std::string(".address");
                         try {
-                            values = conn.getDeviceVariableValue(master, addressDeviceName);
+                            values = getDeviceVariableValue(master, addressDeviceName);
                             if (values.size() > 0) {
                                 std::string subAddressDevice = values.at(0);
                                 log_debug("sa: get device sub address: %s", subAddressDevice.c_str());
@@ -260,7 +279,7 @@ void Sensors::updateSensorList (nut::Client &conn, mlm_client_t *client)
                     log_debug ("sa: parentSerialNumberName=%s", parentSerialNumberName.c_str());
                     std::vector<std::string> values = {};
                     try {
-                        values = conn.getDeviceVariableValue(master, parentSerialNumberName);
+                        values = getDeviceVariableValue(master, parentSerialNumberName);
                     } catch (std::exception& e) {
                         log_error("Nut object %s not found for (%s): %s", parentSerialNumberName.c_str(),
                             master.c_str(), e.what());
@@ -293,7 +312,7 @@ void Sensors::updateSensorList (nut::Client &conn, mlm_client_t *client)
                     std::string addressDeviceName = prefix + std::string("ambient.") + port + std::string(".address");
                     log_debug("sa: index=%d addressDeviceName='%s'", index, addressDeviceName.c_str());
                     try {
-                        std::vector<std::string> values1 = conn.getDeviceVariableValue(master, addressDeviceName);
+                        std::vector<std::string> values1 = getDeviceVariableValue(master, addressDeviceName);
                         if (values1.size() > 0) {
                             std::string addressDevice = values1.at(0);
                             log_debug("sa: set device sub address: %s", addressDevice.c_str());
@@ -346,77 +365,82 @@ void Sensors::publish(mlm_client_t* client, int ttl)
 
 void Sensors::removeInventory(std::string name)
 {
-    const auto& it_hash = _lastInventoryHashs.find(name);
-    if (it_hash != _lastInventoryHashs.end()) {
-        _lastInventoryHashs.erase(it_hash);
-    }
+    NutDigests.erase(name);
+    _inventoryTimestamps.erase(name);
 }
 
 bool Sensors::isInventoryChanged(std::string name)
 {
     const auto& it_sensor = _sensors.find(name);
-    if (it_sensor != _sensors.end()) {
-        std::string buffer;
-        for (const auto& item : it_sensor->second.inventory()) {
-            buffer += item.first + item.second;
-        }
-        if (!buffer.empty()) {
-            log_debug("sa: publish sensor inventory for %s: buffer=%s", it_sensor->second.assetName().c_str(),
-                buffer.c_str());
-            std::size_t hash = std::hash<std::string>{}(buffer);
-            const auto& it_hash = _lastInventoryHashs.find(name);
-            if (it_hash != _lastInventoryHashs.end() && hash == it_hash->second) {
-                return false;
-            } else {
-                log_debug("sa: publish sensor inventory for %s: %lu <> %lu", it_sensor->second.assetName().c_str(),
-                    hash, it_hash->second);
-                _lastInventoryHashs[name] = hash;
-                return true;
-            }
-        }
+    return it_sensor != _sensors.end() && isInventoryChanged(it_sensor->second);
+}
+
+bool Sensors::isInventoryChanged(const Sensor& sensor, uint64_t* digest_p)
+{
+    if (sensor.inventory().empty()) {
+        return false;
+    }
+    InventoryDigest digest;
+    for (const auto& item : sensor.inventory()) {
+        digest.add(item.first, item.second);
     }
-    return false;
+    // digests of the last published inventories survive restarts
+    auto last = NutDigests.get(sensor.assetName());
+    if (last == digest.value()) {
+        return false;
+    }
+    log_debug("sa: publish sensor inventory for %s: %016" PRIx64 " <> %016" PRIx64, sensor.assetName().c_str(),
+        digest.value(), last.value_or(0));
+    if (digest_p) {
+        *digest_p = digest.value();
+    }
+    return true;
 }
 
 void Sensors::advertiseInventory(mlm_client_t* client)
 {
-    bool advertiseAll = false;
-    if (_inventoryTimestamp_ms + NUT_INVENTORY_REPEAT_AFTER_MS < static_cast<uint64_t>(zclock_mono())) {
-        advertiseAll = true;
-        _inventoryTimestamp_ms = static_cast<uint64_t>(zclock_mono());
-    }
+    uint64_t now = static_cast<uint64_t>(zclock_time());
 
     for (auto& sensor : _sensors) {
-        // send inventory only if change
-        // Note: need to update last inventory before testing advertiseAll
-        if (isInventoryChanged(sensor.second.assetName()) || advertiseAll) {
+        // send inventory only if change, the digest is kept once it is sent
+        uint64_t digest  = 0;
+        bool     changed = isInventoryChanged(sensor.second, &digest);
+
+        // whole inventory is repeated once in a while, each sensor at its own time of the period
+        bool      advertiseAll = false;
+        uint64_t& timestamp    = _inventoryTimestamps[sensor.first];
+        if (timestamp == 0 && !changed) {
+            // the same inventory was published before a restart
+            timestamp = now;
+        } else if (inventoryDue(sensor.second.assetName(), timestamp, now, NUT_INVENTORY_REPEAT_AFTER_MS)) {
+            advertiseAll = true;
+            timestamp    = now;
+        }
+        if (changed || advertiseAll) {
             log_debug("sa: publish sensor inventory for %s", sensor.second.assetName().c_str());
 
             std::string log;
-            zhash_t*    inventory = zhash_new();
-            zhash_autofree(inventory);
+            // not autofree, values stay in the sensor until the message is encoded
+            zhash_t* inventory = zhash_new();
             for (auto& item : sensor.second.inventory()) {
                 zhash_insert(inventory, item.first.c_str(), const_cast<char*>(item.second.c_str()));
                 log += item.first + " = \"" + item.second + "\"; ";
             }
             if (zhash_size(inventory) != 0) {
-                zmsg_t* message =
-                    fty_proto_encode_asset(NULL, sensor.second.assetName().c_str(), "inventory", inventory);
+                zmsg_t* message = encodeInventory(sensor.second.assetName(), &inventory);
 
                 if (message) {
-                    std::string topic = "inventory@" + sensor.second.assetName();
+                    std::string topic = inventoryTopic(sensor.second.assetName());
                     log_debug("new sensor inventory message '%s': %s", topic.c_str(), log.c_str());
-                    // FIXME: a hack for inventory messages ???
-                    // fty_proto_t *m_decoded = fty_proto_decode(&message);
-                    // zmsg_destroy(&message);
-                    // message = fty_proto_encode(&m_decoded);
                     int r = mlm_client_send(client, topic.c_str(), &message);
                     if (r != 0)
                         log_error("failed to send inventory %s result %" PRIi32, topic.c_str(), r);
+                    else if (changed)
+                        NutDigests.set(sensor.second.assetName(), digest);
                     zmsg_destroy(&message);
                 }
-                zhash_destroy(&inventory);
             }
+            zhash_destroy(&inventory);
         }
     }
 }
@@ -430,6 +454,7 @@ void Sensors::loadSensorMapping(const char* path_to_file)
         log_debug("Loading sensor inventory mapping...");
         _sensorInventoryMapping = fty::nut::loadMapping(path_to_file, "sensorInventoryMapping");
         log_debug("Number of entries loaded for sensor inventory mapping: %zu", _sensorInventoryMapping.size());
+        _sensorInventory.load({_sensorInventoryMapping});
 
         _sensorMappingLoaded = true;
     } catch (std::exception& e) {
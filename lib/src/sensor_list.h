@@ -23,14 +23,17 @@
 
 #include "sensor_device.h"
 #include "state_manager.h"
+#include <functional>
+#include <nutclient.h>
 
 class Sensors
 {
 public:
     explicit Sensors(StateManager::Reader* reader);
-    void                                      updateFromNUT(nut::TcpClient& conn);
+    void                                      updateFromNUT(const NutSnapshot& snapshot);
     bool                                      updateAssetConfig(AssetState::Asset* asset, mlm_client_t* client);
     void                                      updateSensorList(nut::Client& conn, mlm_client_t* client);
+    void                                      updateSensorList(const NutSnapshot& snapshot, mlm_client_t* client);
     void                                      publish(mlm_client_t* client, int ttl);
     void removeInventory(std::string name);
     bool isInventoryChanged(std::string name);
@@ -44,12 +47,19 @@ public:
     std::map<std::string, Sensor>& sensors();
 
 protected:
+    // (device, variable) -> value, throws if not available
+    typedef std::function<std::vector<std::string>(const std::string&, const std::string&)> VariableReader;
+    void updateSensorList(const VariableReader& getDeviceVariableValue, mlm_client_t* client);
+    /// compares the digest of the inventory of the sensor with the last published one,
+    /// gives the new one in `digest`, which the caller keeps once it is published
+    bool isInventoryChanged(const Sensor& sensor, uint64_t* digest = nullptr);
+
     std::map<std::string, Sensor>         _sensors; // name | Sensor
-    std::map<std::string, std::size_t>    _lastInventoryHashs;
     std::unique_ptr<StateManager::Reader> _state_reader;
-    // [ms] it is not an actual timestamp, it is just a reference point in time, when inventory was advertised
-    uint64_t                           _inventoryTimestamp_ms = 0;
+    // [ms] wall clock of the last whole inventory of each sensor, see inventoryDue()
+    std::map<std::string, uint64_t>    _inventoryTimestamps;
     std::map<std::string, std::string> _sensorInventoryMapping; //!< sensor inventory mapping
+    NutMapping                         _sensorInventory;        //!< sensor inventory mapping, compiled
     bool _sensorMappingLoaded = false;
     bool _sensorListError = false;  // Flag to detect if error during initialisation of sensors list
 };
@@ -0,0 +1,292 @@
+/*  =========================================================================
+    status_decoder - decoding of ups.status and ups.alarm without allocation
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#include "status_decoder.h"
+#include "ups_status.h"
+#include <cassert>
+#include <limits>
+
+namespace {
+
+struct StatusToken
+{
+    std::string_view name;
+    uint16_t         flag;
+};
+
+// same tokens as status_info of ups_status.cc (dummy-ups.h of NUT)
+constexpr StatusToken s_tokens[] = {
+    {"CAL", STATUS_CAL},
+    {"TRIM", STATUS_TRIM},
+    {"BOOST", STATUS_BOOST},
+    {"OL", STATUS_OL},
+    {"OB", STATUS_OB},
+    {"OVER", STATUS_OVER},
+    {"LB", STATUS_LB},
+    {"RB", STATUS_RB},
+    {"BYPASS", STATUS_BYPASS},
+    {"OFF", STATUS_OFF},
+    {"CHRG", STATUS_CHRG},
+    {"DISCHRG", STATUS_DISCHRG},
+    {"HB", STATUS_HB},
+    {"FSD", STATUS_FSD},
+    {"ALARM", STATUS_ALARM},
+};
+
+constexpr size_t TABLE_SIZE = 64;
+
+constexpr char s_upper(char c)
+{
+    return c >= 'a' && c <= 'z' ? char(c - 'a' + 'A') : c;
+}
+
+/// FNV-1a of the upper case token, started from `seed`
+constexpr uint32_t s_hash(std::string_view token, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : token) {
+        hash ^= uint8_t(s_upper(c));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+constexpr bool s_collisionFree(uint32_t seed)
+{
+    bool used[TABLE_SIZE] = {};
+    for (const auto& token : s_tokens) {
+        size_t slot = s_hash(token.name, seed) % TABLE_SIZE;
+        if (used[slot]) {
+            return false;
+        }
+        used[slot] = true;
+    }
+    return true;
+}
+
+constexpr uint32_t s_findSeed()
+{
+    uint32_t seed = 0;
+    while (!s_collisionFree(seed)) {
+        seed++;
+    }
+    return seed;
+}
+
+constexpr uint32_t SEED = s_findSeed();
+
+struct Slot
+{
+    std::string_view name;
+    uint16_t         flag = 0;
+};
+
+constexpr std::array<Slot, TABLE_SIZE> s_buildTable()
+{
+    std::array<Slot, TABLE_SIZE> table{};
+    for (const auto& token : s_tokens) {
+        table[s_hash(token.name, SEED) % TABLE_SIZE] = Slot{token.name, token.flag};
+    }
+    return table;
+}
+
+constexpr std::array<Slot, TABLE_SIZE> s_table = s_buildTable();
+
+/// bit n is set if some token has n characters
+constexpr uint32_t s_lengths()
+{
+    uint32_t lengths = 0;
+    for (const auto& token : s_tokens) {
+        lengths |= uint32_t(1) << token.name.size();
+    }
+    return lengths;
+}
+
+constexpr uint32_t LENGTHS = s_lengths();
+
+constexpr bool s_prefixFree()
+{
+    for (const auto& token : s_tokens) {
+        for (const auto& other : s_tokens) {
+            if (&token != &other && other.name.substr(0, token.name.size()) == token.name) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// a token may be matched by its prefix, which has to be unambiguous
+static_assert(s_prefixFree(), "no status token may start with another one");
+
+uint16_t s_lookup(std::string_view token)
+{
+    const Slot& slot = s_table[s_hash(token, SEED) % TABLE_SIZE];
+    if (slot.name.size() != token.size()) {
+        return 0;
+    }
+    for (size_t i = 0; i < token.size(); i++) {
+        if (s_upper(token[i]) != slot.name[i]) {
+            return 0;
+        }
+    }
+    return slot.flag;
+}
+
+} // namespace
+
+uint16_t decodeUpsStatusToken(std::string_view token)
+{
+    if (uint16_t flag = s_lookup(token)) {
+        return flag;
+    }
+    // known token followed by anything, like strncasecmp did
+    for (size_t length = 1; length < token.size() && length < 32; length++) {
+        if (LENGTHS & (uint32_t(1) << length)) {
+            if (uint16_t flag = s_lookup(token.substr(0, length))) {
+                return flag;
+            }
+        }
+    }
+    return 0;
+}
+
+uint16_t decodeUpsStatus(std::string_view status, std::string_view testResult)
+{
+    uint16_t result = 0;
+    while (true) {
+        size_t space = status.find(' ');
+        result |= decodeUpsStatusToken(status.substr(0, space));
+        if (space == std::string_view::npos) {
+            break;
+        }
+        status.remove_prefix(space + 1);
+    }
+    // detect if a test is in progress
+    if (testResult == "in progress") {
+        // add calibration (CAL) flag to ups status
+        result |= STATUS_CAL;
+    }
+
+    // IPMVAL-1889: in some rare case, OL *and* OB bits are unset.
+    // This implies unexpected up/down trigger of onbattery & onacpoweroutage alarms, based on status.ups metric.
+    // In such a case, we try to set OL/OB bits knowing CHRG/DISCHRG bits.
+    if (!(result & (STATUS_OL | STATUS_OB))) {                             // !OL && !OB
+        if ((result & STATUS_CHRG) && !(result & STATUS_DISCHRG)) {        // CHRG && !DISCHRG
+            result |= STATUS_OL;                                           // set OL
+        } else if (!(result & STATUS_CHRG) && (result & STATUS_DISCHRG)) { // !CHRG && DISCHRG
+            result |= STATUS_OB;                                           // set OB
+        }
+    }
+    return result;
+}
+
+PatternMatcher::PatternMatcher(const std::vector<std::string_view>& patterns)
+{
+    assert(patterns.size() <= 32);
+
+    // only bytes of the patterns get their own class
+    for (const auto& pattern : patterns) {
+        for (char c : pattern) {
+            uint8_t& cls = _classes[uint8_t(c)];
+            if (!cls) {
+                assert(_width < 256);
+                cls = uint8_t(_width++);
+            }
+        }
+    }
+
+    // trie of the patterns, 0 is the root and no transition
+    _next.assign(_width, 0);
+    _outputs.assign(1, 0);
+    for (size_t i = 0; i < patterns.size(); i++) {
+        size_t state = 0;
+        for (char c : patterns[i]) {
+            size_t at = state * _width + _classes[uint8_t(c)];
+            if (!_next[at]) {
+                assert(_outputs.size() < std::numeric_limits<uint16_t>::max());
+                _next[at] = uint16_t(_outputs.size());
+                _next.resize(_next.size() + _width, 0);
+                _outputs.push_back(0);
+            }
+            state = _next[at];
+        }
+        _outputs[state] |= uint32_t(1) << i;
+    }
+
+    // breadth first, missing transitions follow the failure link of the
+    // state, which is shallower and resolved already
+    std::vector<uint16_t> fail(_outputs.size(), 0);
+    std::vector<uint16_t> queue;
+    for (size_t cls = 0; cls < _width; cls++) {
+        if (_next[cls]) {
+            queue.push_back(_next[cls]);
+        }
+    }
+    for (size_t head = 0; head < queue.size(); head++) {
+        uint16_t state = queue[head];
+        _outputs[state] |= _outputs[fail[state]];
+        for (size_t cls = 0; cls < _width; cls++) {
+            uint16_t& next     = _next[state * _width + cls];
+            uint16_t  fallback = _next[fail[state] * _width + cls];
+            if (next) {
+                fail[next] = fallback;
+                queue.push_back(next);
+            } else {
+                next = fallback;
+            }
+        }
+    }
+}
+
+uint32_t PatternMatcher::match(std::string_view text) const
+{
+    uint32_t found = 0;
+    size_t   state = 0;
+    for (char c : text) {
+        state = _next[state * _width + _classes[uint8_t(c)]];
+        found |= _outputs[state];
+    }
+    return found;
+}
+
+UpsAlarms decodeUpsAlarms(std::string_view alarms)
+{
+    // reported by some devices instead of "Internal UPS fault!"
+    static constexpr std::string_view INTERNAL_FAILURE = "Internal failure!";
+    static constexpr size_t           INTERNAL_FAULT   = 8;
+    static_assert(UPS_ALARMS[INTERNAL_FAULT] == "Internal UPS fault!");
+
+    static const PatternMatcher matcher = [] {
+        std::vector<std::string_view> patterns(UPS_ALARMS.begin(), UPS_ALARMS.end());
+        patterns.push_back(INTERNAL_FAILURE);
+        return PatternMatcher(patterns);
+    }();
+
+    uint32_t  found = matcher.match(alarms);
+    UpsAlarms result;
+    result.bits   = uint16_t(found & ((uint32_t(1) << UPS_ALARMS.size()) - 1));
+    result.listed = result.bits != 0;
+    if (found & (uint32_t(1) << UPS_ALARMS.size())) {
+        result.bits |= uint16_t(1 << INTERNAL_FAULT);
+    }
+    return result;
+}
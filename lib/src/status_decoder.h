@@ -0,0 +1,96 @@
+/*  =========================================================================
+    status_decoder - decoding of ups.status and ups.alarm without allocation
+
+    Copyright (C) 2014 - 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    =========================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/// Flag (STATUS_*) of one ups.status token, 0 if unknown.
+///
+/// Tokens are looked up in a perfect hash table built at compile time,
+/// case insensitive. A token starting with a known one counts as that one
+/// ("OLX" is OL), as it always did.
+uint16_t decodeUpsStatusToken(std::string_view token);
+
+/// ups.status (e.g. "OL CHRG") and ups.test.result as the STATUS_* bitmap,
+/// see upsstatus_to_int()
+uint16_t decodeUpsStatus(std::string_view status, std::string_view testResult);
+
+/// Finds which of up to 32 patterns occur in a text, in one pass over it.
+///
+/// Aho-Corasick automaton with all transitions resolved, over the bytes
+/// used by the patterns: each byte of the text costs one table lookup.
+///
+///     PatternMatcher matcher({"Fan failure!", "Fuse fault!"});
+///     matcher.match("Fuse fault! Fan failure!"); // 0b11
+class PatternMatcher
+{
+public:
+    explicit PatternMatcher(const std::vector<std::string_view>& patterns);
+
+    /// bit i is set if patterns[i] occurs in text
+    uint32_t match(std::string_view text) const;
+
+    /// number of states of the automaton
+    size_t states() const
+    {
+        return _outputs.size();
+    }
+
+private:
+    std::array<uint8_t, 256> _classes{}; //!< byte to its class, 0 for bytes of no pattern
+    size_t                   _width = 1; //!< number of classes
+    std::vector<uint16_t>    _next;      //!< next state, at state * _width + class
+    std::vector<uint32_t>    _outputs;   //!< patterns ending in each state
+};
+
+/// Alarms of ups.alarm, published as bit i of the metric
+// clang-format off
+inline constexpr std::array<std::string_view, 14> UPS_ALARMS = {
+    "Replace battery!",
+    "Shutdown imminent!",
+    "Fan failure!",
+    "No battery installed!",
+    "Battery voltage too low!",
+    "Battery voltage too high!",
+    "Battery charger fail!",
+    "Temperature too high!",
+    "Internal UPS fault!",
+    "Awaiting power!",
+    "Automatic bypass mode!",
+    "Manual bypass mode!",
+    "Communication fault!",
+    "Fuse fault!"
+};
+// clang-format on
+
+struct UpsAlarms
+{
+    uint16_t bits   = 0;     //!< bit i for UPS_ALARMS[i]
+    bool     listed = false; //!< one of UPS_ALARMS is present, not only an alias
+};
+
+/// Alarms found in the ups.alarm text of NUT (substrings, case sensitive).
+/// "Internal failure!" reports "Internal UPS fault!" but is not listed.
+UpsAlarms decodeUpsAlarms(std::string_view alarms);
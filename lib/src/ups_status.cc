@@ -21,9 +21,8 @@
 
 
 #include "ups_status.h"
-#include <cassert>
-#include <cstring>
-#include <fty_common_base.h>
+#include "status_decoder.h"
+#include <cstdlib>
 
 // following definition is taken as it is from network ups tool project (dummy-ups.h):
 typedef struct
@@ -33,7 +32,7 @@ typedef struct
 } status_lkp_t;
 
 // following definition is taken as it is from network ups tool project (dummy-ups.h):
-// Status lookup table
+// Status lookup table, decoding is done by status_decoder
 static status_lkp_t status_info[] = {
     {"CAL", STATUS_CAL},
     {"TRIM", STATUS_TRIM},
@@ -53,71 +52,14 @@ static status_lkp_t status_info[] = {
     {"NULL", 0},
 };
 
-static uint16_t s_upsstatus_single_status_to_int(const char* status)
-{
-    if (!status)
-        return 0;
-
-    int i = 0;
-    while (true) {
-        if (status_info[i].status_value == 0) {
-            // end of array, not found
-            return 0;
-        }
-        if (strncasecmp(status_info[i].status_str, status, strlen(status_info[i].status_str)) == 0) {
-            return uint16_t(status_info[i].status_value);
-        }
-        i++;
-    }
-}
-
-
 uint16_t upsstatus_to_int(const char* status, const char* test_result)
 {
-    int   result = 0;
-    char* buff   = strdup(status);
-    char* b      = buff;
-    char* e;
-
-    if (!buff) {
-        return 0;
-    }
-    while (b) {
-        e = strchr(b, ' ');
-        if (e) {
-            *e = 0;
-            e++;
-        }
-        result |= s_upsstatus_single_status_to_int(b);
-        b = e;
-    }
-    if (buff) {
-        free(buff);
-        buff = NULL;
-    }
-    // detect if a test is in progress
-    if (streq(test_result, "in progress")) {
-        // add calibration (CAL) flag to ups status
-        result |= s_upsstatus_single_status_to_int("CAL");
-    }
-
-    // IPMVAL-1889: in some rare case, OL *and* OB bits are unset.
-    // This implies unexpected up/down trigger of onbattery & onacpoweroutage alarms, based on status.ups metric.
-    // In such a case, we try to set OL/OB bits knowing CHRG/DISCHRG bits.
-    if (!(result & (STATUS_OL | STATUS_OB))) {                             // !OL && !OB
-        if ((result & STATUS_CHRG) && !(result & STATUS_DISCHRG)) {        // CHRG && !DISCHRG
-            result |= STATUS_OL;                                           // set OL
-        } else if (!(result & STATUS_CHRG) && (result & STATUS_DISCHRG)) { // !CHRG && DISCHRG
-            result |= STATUS_OB;                                           // set OB
-        }
-    }
-
-    return uint16_t(result);
+    return decodeUpsStatus(status ? status : "", test_result ? test_result : "");
 }
 
 uint16_t upsstatus_to_int(const std::string& status, const std::string& test_result)
 {
-    return upsstatus_to_int(status.c_str(), test_result.c_str());
+    return decodeUpsStatus(status, test_result);
 }
 
 std::string upsstatus_to_string(uint16_t status)
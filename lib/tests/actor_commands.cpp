@@ -198,6 +198,116 @@ TEST_CASE("actor commands test")
     CHECK(nut_agent.isMappingLoaded() == true);
     CHECK(nut_agent.TTL() == 300);
 
+    // WORKERS
+    CHECK(nut_agent.pollingWorkers() == 1);
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_WORKERS);
+    zmsg_addstr(message, "4");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(actor_polling == 150000);
+    CHECK(nut_agent.pollingWorkers() == 4);
+
+    // WORKERS - bad value, falls back to one worker
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_WORKERS);
+    zmsg_addstr(message, "0");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.pollingWorkers() == 1);
+
+    // WORKERS - trailing characters are not a number either
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_WORKERS);
+    zmsg_addstr(message, "2 workers");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.pollingWorkers() == 1);
+
+    // STATUS_POLLING
+    CHECK(nut_agent.statusPolling() == 0);
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_STATUS_POLLING);
+    zmsg_addstr(message, "2.5");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(actor_polling == 150000);
+    CHECK(nut_agent.statusPolling() == 2500);
+
+    // STATUS_POLLING - bad value disables the lane
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_STATUS_POLLING);
+    zmsg_addstr(message, "2s");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.statusPolling() == 0);
+
+    // NOTIFY
+    CHECK(nut_agent.notifyEndpoint().empty());
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_NOTIFY);
+    zmsg_addstr(message, "inproc://nut-notify");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.notifyEndpoint() == "inproc://nut-notify");
+
+    // DEADBANDS
+    CHECK(nut_agent.deadbands("voltage.*=1,realpower.*=2%"));
+    CHECK_FALSE(nut_agent.deadbands("voltage.*"));
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_DEADBANDS);
+    zmsg_addstr(message, "voltage.*=1");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(actor_polling == 150000);
+
+    // DEVICE_POLLING
+    CHECK(nut_agent.devicePolling("ups=10,epdu=60"));
+    CHECK_FALSE(nut_agent.devicePolling("ups"));
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_DEVICE_POLLING);
+    zmsg_addstr(message, "sts=30");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(actor_polling == 150000);
+    CHECK(nut_agent.polling() == 150000);
+
+    // PUBLISH
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_PUBLISH);
+    zmsg_addstr(message, "300");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.publishInterval() == 300000);
+
+    // PUBLISH_MIN_MAX
+    message = zmsg_new();
+    REQUIRE(message);
+    zmsg_addstr(message, ACTION_PUBLISH_MIN_MAX);
+    zmsg_addstr(message, "true");
+    rv = actor_commands(client, &message, actor_polling, nut_agent);
+    REQUIRE(rv == 0);
+    CHECK(message == nullptr);
+    CHECK(nut_agent.publishMinMax());
+
     STDERR_NON_EMPTY
 
     zmsg_destroy(&message);
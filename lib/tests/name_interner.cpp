@@ -0,0 +1,56 @@
+#include "src/name_interner.h"
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("name interner")
+{
+    NameInterner names;
+    CHECK(names.size() == 1);
+    CHECK(names.id("") == 0);
+    CHECK(names.name(0).empty());
+
+    NameId load = names.id("ups.load");
+    CHECK(load != 0);
+    CHECK(names.id(std::string("ups.load")) == load);
+    CHECK(names.id("ups.", "load") == load);
+    CHECK(names.name(load) == "ups.load");
+
+    CHECK(names.find("ups.", "load") == load);
+    CHECK_FALSE(names.find("ups.status"));
+    CHECK(names.size() == 2);
+
+    // names keep their address when more are interned
+    const std::string* address = &names.name(load);
+    for (int i = 0; i < 1000; i++) {
+        names.id("outlet." + std::to_string(i) + ".realpower");
+    }
+    CHECK(&names.name(load) == address);
+    CHECK(names.size() == 1002);
+    CHECK_THROWS_AS(names.name(NameId(names.size())), std::out_of_range);
+}
+
+TEST_CASE("name interner threads")
+{
+    NameInterner             names;
+    std::vector<std::thread> threads;
+    std::vector<NameId>      ids(4 * 100);
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&names, &ids, t]() {
+            for (int i = 0; i < 100; i++) {
+                ids[size_t(t * 100 + i)] = names.id("outlet.", std::to_string(i) + ".current");
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    // all threads got the same ids for the same names
+    CHECK(names.size() == 101);
+    for (int i = 0; i < 100; i++) {
+        for (int t = 1; t < 4; t++) {
+            CHECK(ids[size_t(t * 100 + i)] == ids[size_t(i)]);
+        }
+        CHECK(names.name(ids[size_t(i)]) == "outlet." + std::to_string(i) + ".current");
+    }
+}
@@ -0,0 +1,39 @@
+#include "src/nut_agent.h"
+#include "src/state_manager.h"
+#include <catch2/catch.hpp>
+#include <malamute.h>
+
+TEST_CASE("nut agent notifications")
+{
+    StateManager manager;
+    NUTAgent     nut_agent(manager.getReader());
+    // never connected, nothing is sent for devices which are not monitored
+    mlm_client_t* client = mlm_client_new();
+    REQUIRE(client);
+    nut_agent.setClient(client);
+
+    // as fty_nut_server binds it, fty-nut-notify pushes to it
+    zsock_t* notify = zsock_new_pull("@inproc://nut-agent-notify-test");
+    REQUIRE(notify);
+    zsock_t* upsmon = zsock_new_push(">inproc://nut-agent-notify-test");
+    REQUIRE(upsmon);
+
+    auto snapshot = NutSnapshots.get();
+
+    // UPSNAME/NOTIFYTYPE, upsmon names the device ups@host
+    zstr_sendx(upsmon, "epdu-1@localhost", "ONBATT", nullptr);
+    CHECK(nut_agent.onNotify(notify) == "epdu-1");
+
+    // the device is not monitored, no new snapshot
+    zstr_sendx(upsmon, "ups-2", "ONLINE", nullptr);
+    CHECK(nut_agent.onNotify(notify) == "ups-2");
+    CHECK(NutSnapshots.get() == snapshot);
+
+    // malformed, no notification type
+    zstr_sendx(upsmon, "ups-2", nullptr);
+    CHECK(nut_agent.onNotify(notify).empty());
+
+    zsock_destroy(&upsmon);
+    zsock_destroy(&notify);
+    mlm_client_destroy(&client);
+}
@@ -0,0 +1,175 @@
+#include "src/nut_async_client.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using drivers::nut::NutAsyncClient;
+using drivers::nut::NutResponseParser;
+
+TEST_CASE("nut response tokenizer")
+{
+    auto tokens = NutResponseParser::tokenize("VAR ups-1 ups.mfr \"Eaton \\\"Corp\\\" \\\\ 5\"");
+    REQUIRE(tokens.size() == 4);
+    CHECK(tokens[0] == "VAR");
+    CHECK(tokens[2] == "ups.mfr");
+    CHECK(tokens[3] == "Eaton \"Corp\" \\ 5");
+
+    tokens = NutResponseParser::tokenize("VAR ups-1 ups.id \"\"");
+    REQUIRE(tokens.size() == 4);
+    CHECK(tokens[3].empty());
+}
+
+TEST_CASE("nut response parser")
+{
+    const std::string stream =
+        "BEGIN LIST VAR ups-1\n"
+        "VAR ups-1 ups.status \"OL CHRG\"\n"
+        "VAR ups-1 battery.charge \"90\"\n"
+        "END LIST VAR ups-1\n"
+        "ERR UNKNOWN-UPS\n"
+        "VAR epdu outlet.count \"24\"\r\n"
+        "ERR VAR-NOT-SUPPORTED\n";
+
+    // any split of the stream gives the same result
+    for (size_t chunk = 1; chunk <= stream.size(); chunk++) {
+        NutResponseParser        parser;
+        std::vector<std::string> order;
+        NutSnapshot::DeviceVars  ups;
+
+        parser.expectListVar("ups-1", [&](const std::string& error, NutSnapshot::DeviceVars&& vars) {
+            CHECK(error.empty());
+            ups = std::move(vars);
+            order.push_back("ups-1");
+        });
+        parser.expectListVar("ups-2", [&](const std::string& error, NutSnapshot::DeviceVars&& vars) {
+            CHECK(error == "UNKNOWN-UPS");
+            CHECK(vars.empty());
+            order.push_back("ups-2");
+        });
+        parser.expectGetVar("epdu", "outlet.count", [&](const std::string& error, std::vector<std::string>&& value) {
+            CHECK(error.empty());
+            REQUIRE(value.size() == 1);
+            CHECK(value[0] == "24");
+            order.push_back("epdu");
+        });
+        parser.expectGetVar("epdu", "outlet.1.current", [&](const std::string& error, std::vector<std::string>&&) {
+            CHECK(error == "VAR-NOT-SUPPORTED");
+            order.push_back("epdu-2");
+        });
+        CHECK(parser.pending() == 4);
+
+        for (size_t i = 0; i < stream.size(); i += chunk) {
+            parser.feed(stream.data() + i, std::min(chunk, stream.size() - i));
+        }
+        CHECK(parser.pending() == 0);
+        CHECK(order == std::vector<std::string>{"ups-1", "ups-2", "epdu", "epdu-2"});
+        REQUIRE(ups.size() == 2);
+        CHECK(ups.get("ups.status") == std::string_view("OL CHRG"));
+        CHECK(ups.get("battery.charge") == std::string_view("90"));
+    }
+
+    // response which does not belong to the pending request
+    NutResponseParser parser;
+    parser.expectGetVar("epdu", "outlet.count", [](const std::string&, std::vector<std::string>&&) {});
+    const std::string wrong = "VAR ups-1 outlet.count \"1\"\n";
+    CHECK_THROWS_AS(parser.feed(wrong.data(), wrong.size()), std::runtime_error);
+
+    // nothing is pending
+    NutResponseParser idle;
+    CHECK_THROWS_AS(idle.feed(wrong.data(), wrong.size()), std::runtime_error);
+}
+
+TEST_CASE("nut async client pipelining")
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    struct sockaddr_in address = {};
+    address.sin_family         = AF_INET;
+    address.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(listen(listener, 1) == 0);
+    socklen_t length = sizeof(address);
+    REQUIRE(getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length) == 0);
+    int port = ntohs(address.sin_port);
+
+    const int devices = 200;
+
+    // fake upsd: answers only after it got a whole window of requests, so
+    // the test would time out if the client waited for each response
+    std::thread server([listener]() {
+        int         fd = accept(listener, nullptr, nullptr);
+        std::string requests;
+        char        buffer[4096];
+        for (int answered = 0; answered < devices;) {
+            int window = std::min(int(NutAsyncClient::MAX_IN_FLIGHT), devices - answered);
+            while (std::count(requests.begin(), requests.end(), '\n') < window) {
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                requests.append(buffer, size_t(n));
+            }
+            std::string response;
+            for (int i = 0; i < window; i++) {
+                size_t      end    = requests.find('\n');
+                std::string device = requests.substr(strlen("LIST VAR "), end - strlen("LIST VAR "));
+                int         index  = std::stoi(device.substr(strlen("ups-")));
+                requests.erase(0, end + 1);
+                if (index == 7) {
+                    response += "ERR UNKNOWN-UPS\n";
+                    continue;
+                }
+                response += "BEGIN LIST VAR " + device + "\n";
+                response += "VAR " + device + " ups.status \"OL\"\n";
+                response += "VAR " + device + " ups.load \"" + std::to_string(index) + "\"\n";
+                response += "END LIST VAR " + device + "\n";
+            }
+            for (size_t sent = 0; sent < response.size();) {
+                ssize_t n = write(fd, response.data() + sent, response.size() - sent);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                sent += size_t(n);
+            }
+            answered += window;
+        }
+        close(fd);
+    });
+
+    NutAsyncClient client;
+    client.connect("127.0.0.1", port);
+    REQUIRE(client.isConnected());
+
+    std::set<std::string> names;
+    for (int i = 0; i < devices; i++) {
+        names.insert("ups-" + std::to_string(i));
+    }
+    auto result = client.getDevicesVariableValues(names);
+    server.join();
+    close(listener);
+
+    CHECK(result.size() == devices - 1);
+    CHECK(result.count("ups-7") == 0);
+    CHECK(result["ups-42"]->get("ups.load") == std::string_view("42"));
+    CHECK(result["ups-199"]->get("ups.status") == std::string_view("OL"));
+
+    // the server has closed the session
+    client.getVar("ups-1", "ups.status", [](const std::string&, std::vector<std::string>&&) {});
+    CHECK_THROWS_AS(client.run(1000), std::runtime_error);
+    CHECK_FALSE(client.isConnected());
+}
+
+TEST_CASE("nut async client unreachable")
+{
+    NutAsyncClient client;
+    CHECK_THROWS_AS(client.connect("127.0.0.1", 9), std::runtime_error);
+    CHECK_FALSE(client.isConnected());
+    CHECK_THROWS_AS(client.run(), std::runtime_error);
+}
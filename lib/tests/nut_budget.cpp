@@ -0,0 +1,73 @@
+#include "src/nut_budget.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("poll budget shed levels")
+{
+    CHECK(PollBudget::shedLevel("realpower.outlet.1") == PollBudget::Outlets);
+    CHECK(PollBudget::shedLevel("status.outlet.12") == PollBudget::Outlets);
+    CHECK(PollBudget::shedLevel("current.outlet.group.1") == PollBudget::Outlets);
+    CHECK(PollBudget::shedLevel("voltage.input.L1-N") == PollBudget::Measurements);
+    CHECK(PollBudget::shedLevel("load.default") == PollBudget::Measurements);
+    CHECK(PollBudget::shedLevel("realpower.default") == PollBudget::None);
+    CHECK(PollBudget::shedLevel("status.ups") == PollBudget::None);
+}
+
+TEST_CASE("poll budget sheds when over budget")
+{
+    PollBudget budget(50);
+    CHECK(budget.keepMetric("realpower.outlet.1"));
+    CHECK(budget.keepInventory());
+
+    // first cycle starts the window
+    CHECK_FALSE(budget.endCycle(1000, 10000));
+    budget.add(PollBudget::Phase::Fetch, 4000000);
+    budget.add(PollBudget::Phase::Transform, 1000000);
+    budget.add(PollBudget::Phase::Publish, 2000000);
+    CHECK_FALSE(budget.endCycle(5000, 10000));
+    // 7 s of 10 s
+    CHECK(budget.endCycle(11000, 10000));
+    CHECK(budget.load() == 70);
+    CHECK(budget.level() == PollBudget::Outlets);
+    CHECK(budget.stats().overruns == 1);
+    CHECK(budget.stats().phaseUs[0] == 4000000);
+
+    CHECK_FALSE(budget.keepMetric("realpower.outlet.1"));
+    CHECK(budget.keepMetric("voltage.input.L1-N"));
+    CHECK(budget.keepInventory());
+
+    budget.add(PollBudget::Phase::Fetch, 9000000);
+    CHECK(budget.endCycle(21000, 10000));
+    CHECK(budget.level() == PollBudget::Inventory);
+    CHECK_FALSE(budget.keepInventory(3));
+
+    budget.add(PollBudget::Phase::Fetch, 9000000);
+    CHECK(budget.endCycle(31000, 10000));
+    CHECK(budget.level() == PollBudget::Measurements);
+    CHECK_FALSE(budget.keepMetric("voltage.input.L1-N"));
+    CHECK(budget.keepMetric("realpower.default"));
+    CHECK(budget.keepMetric("status.ups"));
+
+    // at max, stays there
+    budget.add(PollBudget::Phase::Fetch, 9000000);
+    CHECK(budget.endCycle(41000, 10000));
+    CHECK(budget.level() == PollBudget::Measurements);
+
+    // in between, stays there too
+    budget.add(PollBudget::Phase::Fetch, 3000000);
+    CHECK(budget.endCycle(51000, 10000));
+    CHECK(budget.level() == PollBudget::Measurements);
+
+    // under half of the budget, back one level per window
+    budget.add(PollBudget::Phase::Fetch, 1000000);
+    CHECK(budget.endCycle(61000, 10000));
+    CHECK(budget.level() == PollBudget::Inventory);
+    CHECK(budget.endCycle(71000, 10000));
+    CHECK(budget.level() == PollBudget::Outlets);
+    CHECK(budget.endCycle(81000, 10000));
+    CHECK(budget.level() == PollBudget::None);
+    CHECK(budget.keepMetric("realpower.outlet.1"));
+
+    CHECK(budget.stats().skippedMetrics == 2);
+    CHECK(budget.stats().skippedInventories == 3);
+    CHECK(budget.stats().cycles == 10);
+}
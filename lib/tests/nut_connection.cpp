@@ -0,0 +1,42 @@
+#include "src/nut_connection.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("nut connection backoff")
+{
+    using drivers::nut::NutConnection;
+
+    CHECK(NutConnection::backoffMs(0, 0.5) == 0);
+
+    // delay doubles with each failure, jitter stays within the upper half
+    uint64_t previous = 0;
+    for (unsigned failures = 1; failures < 8; failures++) {
+        uint64_t low  = NutConnection::backoffMs(failures, 0.0);
+        uint64_t high = NutConnection::backoffMs(failures, 0.999);
+        CHECK(low <= high);
+        CHECK(high <= 2 * low);
+        CHECK(low >= previous);
+        previous = low;
+    }
+    CHECK(NutConnection::backoffMs(1, 0.0) == NutConnection::BACKOFF_MIN_MS / 2);
+
+    // capped
+    CHECK(NutConnection::backoffMs(100, 0.999) <= NutConnection::BACKOFF_MAX_MS);
+    CHECK(NutConnection::backoffMs(100, 0.0) == NutConnection::BACKOFF_MAX_MS / 2);
+}
+
+TEST_CASE("nut connection unreachable")
+{
+    using drivers::nut::NutConnection;
+
+    // nothing listens on the discard port
+    NutConnection connection("127.0.0.1", 9);
+
+    CHECK(connection.client() == nullptr);
+    CHECK(connection.stats().failures == 1);
+    CHECK(connection.stats().connects == 0);
+
+    // still backing off, no new attempt is made
+    CHECK(connection.client() == nullptr);
+    CHECK(connection.stats().failures == 1);
+    CHECK_FALSE(connection.isConnected());
+}
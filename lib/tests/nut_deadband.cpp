@@ -0,0 +1,80 @@
+#include "src/nut_deadband.h"
+#include <catch2/catch.hpp>
+#include <stdexcept>
+
+TEST_CASE("fixed point")
+{
+    auto check = [](const char* text, int64_t mantissa, uint8_t decimals) {
+        auto value = FixedPoint::parse(text);
+        REQUIRE(value);
+        CHECK(value->mantissa == mantissa);
+        CHECK(value->decimals == decimals);
+        CHECK(value->toString() == text);
+    };
+    check("229.30", 22930, 2);
+    check("-0.05", -5, 2);
+    check("0.5", 5, 1);
+    check("16", 16, 0);
+    check("0", 0, 0);
+    check("123456789012345678", 123456789012345678, 0);
+
+    CHECK(FixedPoint::parse("+1.5")->toString() == "1.5");
+    CHECK(FixedPoint::parse(".5")->toString() == "0.5");
+    CHECK(FixedPoint::parse("5.")->toString() == "5");
+    CHECK(FixedPoint::parse("229.30")->toDouble() == Approx(229.3));
+    CHECK(FixedPoint::parse("-0.05")->toDouble() == Approx(-0.05));
+
+    CHECK_FALSE(FixedPoint::parse(""));
+    CHECK_FALSE(FixedPoint::parse("-"));
+    CHECK_FALSE(FixedPoint::parse("."));
+    CHECK_FALSE(FixedPoint::parse("1e3"));
+    CHECK_FALSE(FixedPoint::parse("N/A"));
+    CHECK_FALSE(FixedPoint::parse("1.2.3"));
+    CHECK_FALSE(FixedPoint::parse(" 1"));
+    CHECK_FALSE(FixedPoint::parse("1234567890123456789"));
+}
+
+TEST_CASE("deadband")
+{
+    auto number = [](const char* text) {
+        return *FixedPoint::parse(text);
+    };
+
+    // default, any change
+    Deadband any;
+    CHECK_FALSE(any.exceeded(number("230.0"), number("230")));
+    CHECK(any.exceeded(number("230.0"), number("230.1")));
+
+    Deadband absolute;
+    absolute.absolute = 1;
+    CHECK_FALSE(absolute.exceeded(number("230"), number("230.9")));
+    CHECK_FALSE(absolute.exceeded(number("230"), number("229.1")));
+    CHECK(absolute.exceeded(number("230"), number("231.5")));
+    CHECK(absolute.exceeded(number("230"), number("228")));
+
+    Deadband percent;
+    percent.percent = 2;
+    CHECK_FALSE(percent.exceeded(number("1000"), number("1015")));
+    CHECK(percent.exceeded(number("1000"), number("1025")));
+    CHECK(percent.exceeded(number("-1000"), number("-1025")));
+}
+
+TEST_CASE("deadband rules")
+{
+    auto rules = DeadbandRules::parse("voltage.*=1, realpower.*=2%,realpower.default=10");
+    CHECK_FALSE(rules.empty());
+
+    CHECK(rules.match("voltage.input.L1").absolute == 1);
+    CHECK(rules.match("voltage.input.L1").percent == 0);
+    CHECK(rules.match("realpower.default").percent == 2);
+    CHECK(rules.match("realpower.default").absolute == 0);
+    CHECK(rules.match("current.input.L1").absolute == 0);
+    CHECK(rules.match("current.input.L1").percent == 0);
+
+    CHECK(DeadbandRules::parse("").empty());
+    CHECK(DeadbandRules::parse(" , ").empty());
+    CHECK_THROWS_AS(DeadbandRules::parse("voltage.*"), std::invalid_argument);
+    CHECK_THROWS_AS(DeadbandRules::parse("=1"), std::invalid_argument);
+    CHECK_THROWS_AS(DeadbandRules::parse("voltage.*=x"), std::invalid_argument);
+    CHECK_THROWS_AS(DeadbandRules::parse("voltage.*=-1"), std::invalid_argument);
+}
@@ -0,0 +1,142 @@
+#include "src/nut_derivation.h"
+#include <catch2/catch.hpp>
+#include <cmath>
+
+static NutVarTable table(const std::map<std::string, std::vector<std::string>>& vars)
+{
+    return NutVarTable(vars);
+}
+
+TEST_CASE("nut derivation 3 phase ups")
+{
+    NutDerivation derivation;
+    auto          nut = table({
+        {"device.type", {"ups"}},
+        {"input.L3-N.voltage", {"230"}},
+        {"output.L3-N.voltage", {"230"}},
+        {"output.L1.realpower", {"1000.5"}},
+        {"output.L2.realpower", {"1000"}},
+        {"ups.L3.realpower", {"999.25"}},
+        {"ups.L1.load", {"10"}},
+        {"ups.L2.load", {"20"}},
+        {"ups.L3.load", {"30"}},
+    });
+
+    NutVarTable vars(&nut);
+    CHECK(derivation.apply("", vars, std::nan("")));
+    CHECK(derivation.compilations() == 1);
+    CHECK(vars.get("input.phases") == std::string_view("3"));
+    CHECK(vars.get("output.phases") == std::string_view("3"));
+    // output.L3 missing, taken from ups.L3
+    CHECK(vars.get("ups.realpower") == std::string_view("2999.75"));
+    CHECK(vars.get("input.L1.realpower") == std::string_view("2999.75"));
+    CHECK(vars.get("input.L2.realpower") == std::string_view("1000"));
+    CHECK(vars.get("ups.load") == std::string_view("20.000000"));
+    CHECK(vars.get("device.type") == std::string_view("ups"));
+
+    // same variables, other values, nothing is resolved again
+    auto next = table({
+        {"device.type", {"ups"}},
+        {"input.L3-N.voltage", {"231"}},
+        {"output.L3-N.voltage", {"231"}},
+        {"output.L1.realpower", {"1"}},
+        {"output.L2.realpower", {"2"}},
+        {"ups.L3.realpower", {"3"}},
+        {"ups.L1.load", {"1"}},
+        {"ups.L2.load", {"2"}},
+        {"ups.L3.load", {"3"}},
+    });
+    NutVarTable nextVars(&next);
+    CHECK(derivation.apply("", nextVars, std::nan("")));
+    CHECK(derivation.compilations() == 1);
+    CHECK(nextVars.get("ups.realpower") == std::string_view("6"));
+    CHECK(nextVars.get("ups.load") == std::string_view("2.000000"));
+
+    // not a number
+    auto bad = table({
+        {"device.type", {"ups"}},
+        {"input.L3-N.voltage", {"231"}},
+        {"output.L3-N.voltage", {"231"}},
+        {"output.L1.realpower", {"1"}},
+        {"output.L2.realpower", {"N/A"}},
+        {"ups.L3.realpower", {"3"}},
+        {"ups.L1.load", {"1"}},
+        {"ups.L2.load", {"N/A"}},
+        {"ups.L3.load", {"3"}},
+    });
+    NutVarTable badVars(&bad);
+    CHECK_FALSE(derivation.apply("", badVars, std::nan("")));
+    // sum stops on the invalid value
+    CHECK(badVars.get("ups.realpower") == std::string_view("1"));
+    CHECK_FALSE(badVars.has("ups.load"));
+}
+
+TEST_CASE("nut derivation epdu")
+{
+    NutDerivation derivation;
+    auto          nut = table({
+        {"device.type", {"pdu"}},
+        {"outlet.count", {"3"}},
+        {"outlet.1.realpower", {"10"}},
+        {"outlet.2.realpower", {"N/A"}},
+        {"outlet.3.realpower", {"20.5"}},
+        {"outlet.4.realpower", {"100"}},
+        {"output.phases", {"1"}},
+    });
+
+    NutVarTable vars(&nut);
+    CHECK(derivation.apply("", vars, 2));
+    CHECK(vars.get("device.type") == std::string_view("epdu"));
+    CHECK(vars.get("input.phases") == std::string_view("1"));
+    // outlets up to outlet.count, invalid ones skipped
+    CHECK(vars.get("ups.realpower") == std::string_view("30.50"));
+    CHECK(vars.get("input.realpower") == std::nullopt);
+    CHECK(vars.get("input.L1.realpower") == std::string_view("30.50"));
+    // 30.5 W of 2 kW
+    CHECK(vars.get("ups.load") == std::string_view("2.000000"));
+
+    // more outlets reported, the plan follows
+    auto more = table({
+        {"device.type", {"pdu"}},
+        {"outlet.count", {"4"}},
+        {"outlet.1.realpower", {"10"}},
+        {"outlet.2.realpower", {"N/A"}},
+        {"outlet.3.realpower", {"20.5"}},
+        {"outlet.4.realpower", {"100"}},
+        {"output.phases", {"1"}},
+    });
+    NutVarTable moreVars(&more);
+    CHECK(derivation.apply("", moreVars, std::nan("")));
+    CHECK(derivation.compilations() == 2);
+    CHECK(moreVars.get("ups.realpower") == std::string_view("130.50"));
+    // max_power unknown
+    CHECK_FALSE(moreVars.has("ups.load"));
+}
+
+TEST_CASE("nut derivation daisy chain and ats")
+{
+    NutDerivation derivation;
+    auto          nut = table({
+        {"device.1.output.current", {"2.5"}},
+        {"device.1.output.voltage", {"230"}},
+        {"device.1.ups.load", {"5"}},
+        {"device.2.input.realpower", {"100"}},
+    });
+
+    NutVarTable vars(&nut);
+    CHECK(derivation.apply("device.1.", vars, std::nan("")));
+    CHECK(vars.get("device.1.ups.realpower") == std::string_view("575"));
+    CHECK(vars.get("device.1.input.realpower") == std::nullopt);
+    CHECK(vars.get("device.1.output.realpower") == std::nullopt);
+    CHECK(vars.get("device.1.input.L1.realpower") == std::string_view("575"));
+    CHECK_FALSE(vars.has("ups.realpower"));
+    CHECK_FALSE(vars.has("device.2.ups.realpower"));
+
+    NutDerivation second;
+    NutVarTable   secondVars(&nut);
+    CHECK(second.apply("device.2.", secondVars, std::nan("")));
+    CHECK(secondVars.get("device.2.ups.realpower") == std::string_view("100"));
+    CHECK(secondVars.get("device.2.output.realpower") == std::string_view("100"));
+    CHECK(secondVars.get("device.2.output.L1.realpower") == std::string_view("100"));
+    CHECK(secondVars.get("device.2.input.L1.realpower") == std::string_view("100"));
+}
@@ -1,5 +1,14 @@
 #include <catch2/catch.hpp>
 #include "src/nut_device.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <fty_proto.h>
+#include <mutex>
+#include <netinet/in.h>
+#include <set>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
 
 TEST_CASE("nut device test")
 {
@@ -11,3 +20,221 @@ TEST_CASE("nut device test")
 
     self.load_mapping(path);
 }
+
+static void addPowerDevice(AssetState& state, const char* name, const char* ip, const char* daisychain = nullptr)
+{
+    fty_proto_t* msg = fty_proto_new(FTY_PROTO_ASSET);
+    REQUIRE(msg);
+    fty_proto_set_name(msg, "%s", name);
+    fty_proto_set_operation(msg, FTY_PROTO_ASSET_OP_CREATE);
+    fty_proto_aux_insert(msg, "type", "device");
+    fty_proto_aux_insert(msg, "subtype", "epdu");
+    fty_proto_ext_insert(msg, "ip.1", "%s", ip);
+    if (daisychain) {
+        fty_proto_ext_insert(msg, "daisy_chain", "%s", daisychain);
+    }
+    state.updateFromProto(msg);
+    fty_proto_destroy(&msg);
+}
+
+TEST_CASE("nut device list update keeps devices")
+{
+    AssetState state;
+    addPowerDevice(state, "epdu-1", "192.0.2.1", "1");
+    addPowerDevice(state, "epdu-2", "192.0.2.1", "2");
+    addPowerDevice(state, "epdu-3", "192.0.2.3");
+    state.recompute();
+
+    drivers::nut::NUTDeviceList list;
+    list.updateDeviceList(state);
+    REQUIRE(list.size() == 3);
+    const drivers::nut::NUTDevice* first  = &list["epdu-1"];
+    const drivers::nut::NUTDevice* second = &list["epdu-2"];
+    CHECK(second->nutName() == "epdu-1");
+    CHECK(second->daisyChainIndex() == 2);
+
+    // one device removed, one added, one moved to another daisy-chain position
+    AssetState next;
+    addPowerDevice(next, "epdu-1", "192.0.2.1", "1");
+    addPowerDevice(next, "epdu-2", "192.0.2.1", "3");
+    addPowerDevice(next, "epdu-4", "192.0.2.4");
+    next.recompute();
+
+    list.updateDeviceList(next);
+    REQUIRE(list.size() == 3);
+    // the same object, bound to the asset of the new state
+    CHECK(&list["epdu-1"] == first);
+    CHECK(list["epdu-1"].assetName() == "epdu-1");
+    CHECK(list["epdu-2"].daisyChainIndex() == 3);
+    CHECK(list["epdu-4"].nutName() == "epdu-4");
+    bool removed = true;
+    for (const auto& device : list) {
+        removed = removed && device.first != "epdu-3";
+    }
+    CHECK(removed);
+}
+
+// Listening loopback socket standing in for upsd, on a free port
+static int s_listen(int& port)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    REQUIRE(listener >= 0);
+    struct sockaddr_in address = {};
+    address.sin_family         = AF_INET;
+    address.sin_addr.s_addr    = htonl(INADDR_LOOPBACK);
+    REQUIRE(bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0);
+    REQUIRE(listen(listener, 1) == 0);
+    socklen_t length = sizeof(address);
+    REQUIRE(getsockname(listener, reinterpret_cast<struct sockaddr*>(&address), &length) == 0);
+    port = ntohs(address.sin_port);
+    return listener;
+}
+
+// Reads requests until `lines` of them are complete, false if the session is closed before
+static bool s_readLines(int fd, std::string& requests, size_t lines)
+{
+    char buffer[4096];
+    while (size_t(std::count(requests.begin(), requests.end(), '\n')) < lines) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            return false;
+        }
+        requests.append(buffer, size_t(n));
+    }
+    return true;
+}
+
+TEST_CASE("nut device list upsd going away")
+{
+    AssetState state;
+    addPowerDevice(state, "epdu-1", "192.0.2.1");
+    state.recompute();
+
+    drivers::nut::NUTDeviceList list;
+    list.load_mapping(SELFTEST_RO "/mapping.conf");
+    list.updateDeviceList(state);
+
+    int port     = 0;
+    int listener = s_listen(port);
+    list.setServer("127.0.0.1", port);
+
+    // the session breaks while reading and upsd is gone when reconnecting
+    std::thread server([listener]() {
+        int         fd = accept(listener, nullptr, nullptr);
+        std::string requests;
+        s_readLines(fd, requests, 1);
+        close(listener);
+        close(fd);
+    });
+    auto names = list.update(std::vector<std::string>{"epdu-1"});
+    server.join();
+
+    CHECK(names.empty());
+    CHECK(list.connectionStats().connects == 1);
+    CHECK(list.connectionStats().failures == 1);
+}
+
+TEST_CASE("nut device list status lane")
+{
+    AssetState state;
+    addPowerDevice(state, "epdu-1", "192.0.2.1", "1");
+    addPowerDevice(state, "epdu-2", "192.0.2.1", "2");
+    state.recompute();
+
+    drivers::nut::NUTDeviceList list;
+    list.load_mapping(SELFTEST_RO "/mapping.conf");
+    list.updateDeviceList(state);
+    REQUIRE(list["epdu-2"].nutName() == "epdu-1");
+
+    int port     = 0;
+    int listener = s_listen(port);
+    list.setServer("127.0.0.1", port);
+
+    // fake upsd with one daisy chain of two ePDUs, records the requests
+    std::map<std::string, std::string> vars = {
+        {"device.count", "2"},
+        {"device.1.ups.status", "OL"},
+        {"device.2.ups.status", "OL"},
+        {"device.1.outlet.count", "24"},
+        {"device.2.outlet.count", "16"},
+        {"device.1.outlet.1.current", "1.5"},
+    };
+    std::vector<std::string> requests;
+    std::mutex               mutex;
+    std::thread              server([&]() {
+        int         fd = accept(listener, nullptr, nullptr);
+        std::string buffer;
+        close(listener);
+        while (s_readLines(fd, buffer, 1)) {
+            std::string response;
+            for (size_t end = buffer.find('\n'); end != std::string::npos; end = buffer.find('\n')) {
+                std::string request = buffer.substr(0, end);
+                buffer.erase(0, end + 1);
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(request);
+                if (request == "LIST VAR epdu-1") {
+                    response += "BEGIN LIST VAR epdu-1\n";
+                    for (const auto& var : vars) {
+                        response += "VAR epdu-1 " + var.first + " \"" + var.second + "\"\n";
+                    }
+                    response += "END LIST VAR epdu-1\n";
+                    continue;
+                }
+                std::string name = request.substr(strlen("GET VAR epdu-1 "));
+                auto        var  = vars.find(name);
+                response += var == vars.end() ? "ERR VAR-NOT-SUPPORTED\n"
+                                              : "VAR epdu-1 " + name + " \"" + var->second + "\"\n";
+            }
+            if (write(fd, response.data(), response.size()) != ssize_t(response.size())) {
+                break;
+            }
+        }
+        close(fd);
+    });
+
+    list.update();
+    CHECK(list["epdu-1"].property("status.ups") == "OL");
+    CHECK(list["epdu-2"].property("outlet.count") == "16");
+    list["epdu-1"].setChanged(false);
+    list["epdu-2"].setChanged(false);
+
+    // nothing new
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.clear();
+    }
+    CHECK(list.updateStatus().empty());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // one GET VAR per variable of the chain, not one per member: the plain
+        // variables once, the "device.N." ones for each member
+        std::set<std::string> unique(requests.begin(), requests.end());
+        CHECK(unique.size() == requests.size());
+        CHECK(requests.size() == 3 * drivers::nut::NUTDeviceList::NUT_STATUS_VARIABLES.size());
+        CHECK(unique.count("GET VAR epdu-1 device.2.ups.status"));
+
+        // the second ePDU runs on battery, its outlets are gone
+        vars["device.2.ups.status"]   = "OB";
+        vars["device.2.outlet.count"] = "0";
+        requests.clear();
+    }
+    CHECK(list.updateStatus() == std::vector<std::string>{"epdu-2"});
+    CHECK(list["epdu-2"].property("status.ups") == "OB");
+    CHECK(list["epdu-2"].changed("status.ups"));
+    // only the status is read, the rest waits for the next full update
+    CHECK(list["epdu-2"].property("outlet.count") == "16");
+    CHECK_FALSE(list["epdu-2"].changed("outlet.count"));
+    CHECK(list["epdu-1"].property("status.ups") == "OL");
+    CHECK_FALSE(list["epdu-1"].changed());
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& request : requests) {
+            CHECK(request.compare(0, strlen("GET VAR "), "GET VAR ") == 0);
+        }
+    }
+
+    // drops the session, the fake upsd is done
+    list.setServer("127.0.0.1", port);
+    server.join();
+}
@@ -0,0 +1,58 @@
+#include "src/nut_key.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("nut key parse")
+{
+    auto check = [](const char* name, uint32_t device, NutKey::Collection collection, uint32_t index,
+                     const char* family) {
+        NutKey key = NutKey::parse(name);
+        INFO(name);
+        CHECK(key.device == device);
+        CHECK(key.collection == collection);
+        CHECK(key.index == index);
+        CHECK(NutNames.name(key.family) == family);
+    };
+    using C = NutKey::Collection;
+    check("device.2.outlet.12.realpower", 2, C::Outlet, 12, "outlet.#.realpower");
+    check("realpower.outlet.12", 0, C::Outlet, 12, "realpower.outlet.#");
+    check("status.outlet.1", 0, C::Outlet, 1, "status.outlet.#");
+    check("current.outlet.group.3", 0, C::OutletGroup, 3, "current.outlet.group.#");
+    check("outlet.group.3.current.status", 0, C::OutletGroup, 3, "outlet.group.#.current.status");
+    check("input.L2-N.voltage", 0, C::Phase, 2, "input.L#-N.voltage");
+    check("voltage.input.L3", 0, C::Phase, 3, "voltage.input.L#");
+    check("ambient.1.humidity.status", 0, C::Ambient, 1, "ambient.#.humidity.status");
+    // only the first element is indexed
+    check("outlet.2.L1.current", 0, C::Outlet, 2, "outlet.#.L1.current");
+
+    // not indexed
+    check("ups.realpower", 0, C::None, 0, "ups.realpower");
+    check("device.1.ups.realpower", 1, C::None, 0, "ups.realpower");
+    check("device.count", 0, C::None, 0, "device.count");
+    check("outlet.count", 0, C::None, 0, "outlet.count");
+    check("input.L1-L2.voltage", 0, C::None, 0, "input.L1-L2.voltage");
+    check("ups.test.result", 0, C::None, 0, "ups.test.result");
+    check("", 0, C::None, 0, "");
+}
+
+TEST_CASE("nut key table")
+{
+    NutKeyTable keys;
+
+    NameId name = NutNames.id("device.3.outlet.7.status");
+    NutKey key  = keys.key(name);
+    CHECK(key.device == 3);
+    CHECK(key.index == 7);
+    CHECK(keys.key(name).family == key.family);
+
+    // and back
+    CHECK(keys.name(key.family, 7, 3) == name);
+    CHECK(NutNames.name(keys.name(key.family, 8, 3)) == "device.3.outlet.8.status");
+    CHECK(NutNames.name(keys.name(key.family, 8)) == "outlet.8.status");
+    CHECK(NutNames.name(keys.name(NutNames.id("input.L#-N.voltage"), 1)) == "input.L1-N.voltage");
+
+    CHECK(keys.prefix(0) == "");
+    CHECK(keys.prefix(2) == "device.2.");
+    const std::string& prefix = keys.prefix(1);
+    keys.prefix(100);
+    CHECK(prefix == "device.1.");
+}
@@ -0,0 +1,145 @@
+#include "src/nut_mapping.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <chrono>
+
+#define SELFTEST_RO "tests/selftest-ro"
+
+/// variables of a 48 outlets ePDU, as read from NUT
+static NutVarTable epduDump(const std::string& prefix = "")
+{
+    NutVarTable vars;
+    vars.add(prefix + "device.mfr", "EATON");
+    vars.add(prefix + "device.model", "EPDU MI 38U-A IN: L6-30P 24A 1P OUT: 36XC13:12XC19");
+    vars.add(prefix + "device.serial", "G207J47019");
+    vars.add(prefix + "device.type", "pdu");
+    vars.add(prefix + "ups.mfr", "EATON");
+    vars.add(prefix + "ups.model", "EPDU MI");
+    vars.add(prefix + "ups.status", "OL");
+    vars.add(prefix + "input.voltage", "229.30");
+    vars.add(prefix + "input.current", "12.45");
+    vars.add(prefix + "input.realpower", "2780");
+    vars.add(prefix + "input.frequency", "50.0");
+    vars.add(prefix + "outlet.count", "48");
+    vars.add(prefix + "outlet.switchable", "yes");
+    for (int group = 1; group <= 6; group++) {
+        std::string name = prefix + "outlet.group." + std::to_string(group) + ".";
+        vars.add(name + "current", "2.07");
+        vars.add(name + "voltage", "229.30");
+        vars.add(name + "realpower", "463");
+        vars.add(name + "power", "475");
+        vars.add(name + "load", "13");
+        vars.add(name + "name", "A" + std::to_string(group));
+    }
+    for (int outlet = 1; outlet <= 48; outlet++) {
+        std::string name = prefix + "outlet." + std::to_string(outlet) + ".";
+        vars.add(name + "id", std::to_string(outlet));
+        vars.add(name + "desc", "Outlet A" + std::to_string(outlet));
+        vars.add(name + "status", outlet % 7 ? "on" : "off");
+        vars.add(name + "switchable", "yes");
+        vars.add(name + "current", std::to_string(outlet % 5) + ".25");
+        vars.add(name + "voltage", "229.30");
+        vars.add(name + "realpower", std::to_string(outlet * 3));
+        vars.add(name + "power", std::to_string(outlet * 3 + 4));
+        vars.add(name + "delay.shutdown", "120");
+        vars.add(name + "delay.start", "0");
+    }
+    vars.seal();
+    return vars;
+}
+
+static fty::nut::KeyValues toKeyValues(const NutVarTable& vars)
+{
+    fty::nut::KeyValues result;
+    vars.forEach([&result](std::string_view name, std::string_view value) {
+        result.emplace(name, value);
+    });
+    return result;
+}
+
+TEST_CASE("nut mapping")
+{
+    const auto physics   = fty::nut::loadMapping(SELFTEST_RO "/mapping.conf", "physicsMapping");
+    const auto inventory = fty::nut::loadMapping(SELFTEST_RO "/mapping.conf", "inventoryMapping");
+
+    NutMapping mapping;
+    mapping.load({physics, inventory});
+
+    const auto dump   = epduDump();
+    const auto values = toKeyValues(dump);
+
+    // same result as the interpreted mapping, also once everything is compiled
+    for (int cycle = 0; cycle < 2; cycle++) {
+        CHECK(mapping.map(0, dump, 0) == fty::nut::performMapping(physics, values, 0));
+        CHECK(mapping.map(1, dump, 0) == fty::nut::performMapping(inventory, values, 0));
+        CHECK(mapping.compiled() == dump.size());
+    }
+    auto mapped = mapping.map(0, dump, 0);
+    CHECK(mapped["realpower.outlet.48"] == "144");
+    CHECK(mapped["load.outlet.group.6"] == "13");
+    CHECK(mapping.map(1, dump, 0)["status.outlet.7"] == "off");
+
+    // device.model and ups.model both map to model
+    std::vector<NutMapping::Value> result;
+    mapping.apply(dump, 0, result);
+    CHECK(std::count_if(result.begin(), result.end(), [](const NutMapping::Value& value) {
+        return value.name == NutNames.id("model");
+    }) == 1);
+
+    // only one of them present
+    NutVarTable single;
+    single.add("ups.model", "EPDU MI");
+    single.seal();
+    CHECK(mapping.map(1, single, 0) == fty::nut::performMapping(inventory, toKeyValues(single), 0));
+    CHECK(mapping.map(1, single, 0)["model"] == "EPDU MI");
+
+    // tables are compiled per daisy-chain index
+    const auto chained  = epduDump("device.2.");
+    const auto compiled = mapping.compiled();
+    CHECK(mapping.map(0, chained, 2) == fty::nut::performMapping(physics, toKeyValues(chained), 2));
+    CHECK(mapping.compiled() == compiled + chained.size());
+
+    // reload forgets the compiled tables
+    mapping.load({});
+    CHECK(mapping.compiled() == 0);
+    mapping.apply(dump, 0, result);
+    CHECK(result.empty());
+}
+
+TEST_CASE("nut mapping benchmark", "[.][benchmark]")
+{
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    using std::chrono::steady_clock;
+
+    const auto physics   = fty::nut::loadMapping(SELFTEST_RO "/mapping.conf", "physicsMapping");
+    const auto inventory = fty::nut::loadMapping(SELFTEST_RO "/mapping.conf", "inventoryMapping");
+    const auto dump      = epduDump();
+    const int  cycles    = 1000;
+
+    // what NUTDevice::update() did before: std::map of the variables, then both mappings
+    auto   start = steady_clock::now();
+    size_t count = 0;
+    for (int i = 0; i < cycles; i++) {
+        auto values = toKeyValues(dump);
+        count += fty::nut::performMapping(physics, values, 0).size();
+        count += fty::nut::performMapping(inventory, values, 0).size();
+    }
+    auto interpreted = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    NutMapping mapping;
+    mapping.load({physics, inventory});
+    std::vector<NutMapping::Value> result;
+    mapping.apply(dump, 0, result);
+
+    start = steady_clock::now();
+    for (int i = 0; i < cycles; i++) {
+        mapping.apply(dump, 0, result);
+        count -= result.size();
+    }
+    auto compiled = duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    CHECK(count == 0);
+    WARN("48 outlets ePDU, " << dump.size() << " variables: performMapping " << interpreted / cycles
+                             << " us/cycle, NutMapping " << compiled / cycles << " us/cycle");
+}
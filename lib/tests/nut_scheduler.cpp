@@ -0,0 +1,72 @@
+#include "src/nut_scheduler.h"
+#include <catch2/catch.hpp>
+#include <stdexcept>
+
+TEST_CASE("polling intervals")
+{
+    auto intervals = PollingIntervals::parse("ups=10, epdu=60,sts=0.5");
+    CHECK_FALSE(intervals.empty());
+    CHECK(intervals.get("ups", 30000) == 10000);
+    CHECK(intervals.get("epdu", 30000) == 60000);
+    CHECK(intervals.get("sts", 30000) == 500);
+    CHECK(intervals.get("rackcontroller", 30000) == 30000);
+
+    CHECK(PollingIntervals::parse("").empty());
+    CHECK_THROWS_AS(PollingIntervals::parse("ups"), std::invalid_argument);
+    CHECK_THROWS_AS(PollingIntervals::parse("=10"), std::invalid_argument);
+    CHECK_THROWS_AS(PollingIntervals::parse("ups=10s"), std::invalid_argument);
+    CHECK_THROWS_AS(PollingIntervals::parse("ups=0"), std::invalid_argument);
+}
+
+TEST_CASE("poll scheduler staggers devices")
+{
+    PollScheduler scheduler;
+    CHECK_FALSE(scheduler.next());
+    CHECK(scheduler.due(1000).empty());
+
+    scheduler.assign({{"ups-1", 10000}, {"ups-2", 10000}, {"ups-3", 10000}, {"ups-4", 10000}, {"epdu-1", 60000}},
+        1000);
+    CHECK(scheduler.size() == 5);
+    CHECK(scheduler.interval("epdu-1") == 60000);
+    CHECK(scheduler.interval("sts-1") == 0);
+
+    // one slot every 2.5 s
+    CHECK(*scheduler.next() == 1000);
+    auto due = scheduler.due(1000);
+    REQUIRE(due.size() == 2);
+    CHECK(due[0] != due[1]);
+    CHECK(*scheduler.next() == 3500);
+    CHECK(scheduler.due(3499).empty());
+    CHECK(scheduler.due(3500) == std::vector<std::string>{"ups-2"});
+    CHECK(scheduler.due(6000) == std::vector<std::string>{"ups-3"});
+    CHECK(scheduler.due(8500) == std::vector<std::string>{"ups-4"});
+    // first one again, one interval later
+    CHECK(*scheduler.next() == 11000);
+    CHECK(scheduler.due(11000) == std::vector<std::string>{"ups-1"});
+
+    // late by more than one interval, starts again from now
+    auto late = scheduler.due(40000);
+    CHECK(late.size() == 4);
+    CHECK(*scheduler.next() == 50000);
+}
+
+TEST_CASE("poll scheduler keeps slots on reassign")
+{
+    PollScheduler scheduler;
+    scheduler.assign({{"ups-1", 10000}, {"ups-2", 10000}}, 0);
+    CHECK(scheduler.due(0) == std::vector<std::string>{"ups-1"});
+    CHECK(*scheduler.next() == 5000);
+
+    // ups-2 keeps its slot, ups-1 is re-timed, ups-3 is new
+    scheduler.assign({{"ups-1", 20000}, {"ups-2", 10000}, {"ups-3", 10000}}, 1000);
+    CHECK(scheduler.size() == 3);
+    CHECK(scheduler.interval("ups-1") == 20000);
+    CHECK(scheduler.due(1000) == std::vector<std::string>{"ups-1"});
+    CHECK(scheduler.due(5000) == std::vector<std::string>{"ups-2"});
+
+    // removed keys are not due anymore
+    scheduler.assign({{"ups-3", 10000}}, 5000);
+    CHECK(scheduler.size() == 1);
+    auto due = scheduler.due(100000);
+    CHECK(due == std::vector<std::string>{"ups-3"});
+}
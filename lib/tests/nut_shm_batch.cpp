@@ -0,0 +1,199 @@
+#include "src/nut_shm_batch.h"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <fty_shm.h>
+
+static const std::map<std::string, std::string> s_units = {{"realpower", "W"}, {"voltage", "V"}};
+
+TEST_CASE("shm batch")
+{
+    struct Written
+    {
+        std::string asset, quantity, value, unit;
+        int         ttl;
+    };
+    std::vector<Written> written;
+    ShmBatch             batch(s_units, [&written](const std::string& asset, const std::string& quantity,
+                                            const std::string& value, const std::string& unit, int ttl) {
+        written.push_back({asset, quantity, value, unit, ttl});
+        return quantity == "voltage.input.L2-N" ? -1 : 0;
+    });
+
+    batch.begin("epdu-1", 60);
+    batch.add(NutNames.id("realpower.default"), "1000");
+    batch.add(NutNames.id("voltage.input.L1-N"), "230");
+    batch.add(NutNames.id("status.outlet.1"), "42", " ", 90);
+    batch.add(NutNames.id("ambient.humidity"), "50");
+    // added again, written once with the last value
+    batch.add(NutNames.id("realpower.default"), "1001");
+    CHECK(batch.size() == 4);
+    CHECK(batch.commit() == 0);
+    CHECK(batch.size() == 0);
+
+    REQUIRE(written.size() == 4);
+    CHECK(written[0].asset == "epdu-1");
+    CHECK(written[0].quantity == "realpower.default");
+    CHECK(written[0].value == "1001");
+    CHECK(written[0].unit == "W");
+    CHECK(written[0].ttl == 60);
+    CHECK(written[1].unit == "V");
+    CHECK(written[2].unit == " ");
+    CHECK(written[2].ttl == 90);
+    CHECK(written[3].unit == "");
+
+    // failures are counted per batch
+    written.clear();
+    batch.begin("ups-1", 30);
+    batch.add(NutNames.id("voltage.input.L1-N"), "231");
+    batch.add(NutNames.id("voltage.input.L2-N"), "232");
+    CHECK(batch.commit() == 1);
+    REQUIRE(written.size() == 2);
+    CHECK(written[0].asset == "ups-1");
+    CHECK(written[0].value == "231");
+    CHECK(written[0].ttl == 30);
+
+    CHECK(batch.stats().batches == 2);
+    CHECK(batch.stats().metrics == 5);
+    CHECK(batch.stats().failures == 1);
+}
+
+TEST_CASE("shm batch writes on change")
+{
+    std::vector<std::string> written;
+    bool                     fail = false;
+    ShmBatch                 batch(s_units, [&](const std::string&, const std::string& quantity,
+                                    const std::string& value, const std::string&, int) {
+        written.push_back(quantity + "=" + value);
+        return fail ? -1 : 0;
+    });
+    const NameId realpower = NutNames.id("realpower.default");
+    const NameId voltage   = NutNames.id("voltage.input.L1-N");
+
+    // ttl 120 s, polled every 30 s: rewritten when expiring within 45 s
+    auto cycle = [&](uint64_t now, const char* power, const char* volts) {
+        written.clear();
+        batch.begin("ups-1", 120, now, 45000);
+        batch.add(realpower, power);
+        batch.add(voltage, volts);
+        return batch.commit();
+    };
+
+    CHECK(cycle(0, "1000", "230") == 0);
+    CHECK(written == std::vector<std::string>{"realpower.default=1000", "voltage.input.L1-N=230"});
+
+    // unchanged, skipped
+    CHECK(cycle(30000, "1000", "230") == 0);
+    CHECK(written.empty());
+    CHECK(batch.stats().skipped == 2);
+
+    // changed one is written at once
+    CHECK(cycle(60000, "1001", "230") == 0);
+    CHECK(written == std::vector<std::string>{"realpower.default=1001"});
+
+    // voltage expires at 120 s, written again before
+    CHECK(cycle(90000, "1001", "230") == 0);
+    CHECK(written == std::vector<std::string>{"voltage.input.L1-N=230"});
+
+    // failed writes are retried
+    fail = true;
+    CHECK(cycle(100000, "1002", "230") == 1);
+    CHECK(written == std::vector<std::string>{"realpower.default=1002"});
+    fail = false;
+    CHECK(cycle(110000, "1002", "230") == 0);
+    CHECK(written == std::vector<std::string>{"realpower.default=1002"});
+
+    // same value with another unit or ttl is written again
+    written.clear();
+    batch.begin("ups-1", 120, 115000, 45000);
+    batch.add(realpower, "1002", "kW");
+    batch.add(voltage, "230", "V", 90);
+    CHECK(batch.commit() == 0);
+    CHECK(written.size() == 2);
+
+    // other assets are independent, forgotten ones written again
+    written.clear();
+    batch.begin("ups-2", 120, 110000, 45000);
+    batch.add(voltage, "230");
+    batch.commit();
+    CHECK(written.size() == 1);
+    batch.forget("ups-1");
+    CHECK(cycle(120000, "1002", "230") == 0);
+    CHECK(written.size() == 2);
+
+    // without refresh window, everything is written
+    written.clear();
+    batch.begin("ups-1", 120);
+    batch.add(realpower, "1002");
+    batch.commit();
+    CHECK(written.size() == 1);
+}
+
+// Not run by default, select it with the "[benchmark]" tag
+TEST_CASE("shm batch benchmark", "[.][benchmark]")
+{
+    // synthetic fleet: 1000 ePDUs with 48 outlets
+    const int devices = 1000;
+    const int outlets = 48;
+
+    std::vector<std::pair<NameId, std::string>> metrics;
+    for (const char* name : {"realpower.default", "voltage.input.L1-N", "current.input.L1", "load.default"}) {
+        metrics.emplace_back(NutNames.id(name), "123.45");
+    }
+    for (int i = 1; i <= outlets; i++) {
+        for (const char* quantity : {"realpower", "current", "voltage"}) {
+            metrics.emplace_back(NutNames.id(std::string(quantity) + ".outlet." + std::to_string(i)), "12.3");
+        }
+    }
+
+    REQUIRE(fty_shm_set_test_dir("shm-batch-benchmark") == 0);
+
+    auto run = [&](const std::string& name, auto&& publish) {
+        auto start = std::chrono::steady_clock::now();
+        for (int device = 0; device < devices; device++) {
+            publish("epdu-" + std::to_string(device));
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%s: %zu writes in %.3f s, %.0f writes/s\n", name.c_str(), metrics.size() * devices, seconds,
+            double(metrics.size() * devices) / seconds);
+    };
+
+    // with fty-shm, then without the file work to see the cost around it: the
+    // writes themselves are the same, fty-shm has no batch API
+    std::vector<std::pair<std::string, ShmBatch::Writer>> writers = {
+        {"fty-shm",
+            [](const std::string& asset, const std::string& quantity, const std::string& value,
+                const std::string& unit, int ttl) {
+                return fty::shm::write_metric(asset, quantity, value, unit, ttl);
+            }},
+        {"no-op",
+            [](const std::string&, const std::string&, const std::string&, const std::string&, int) {
+                return 0;
+            }},
+    };
+    for (const auto& writer : writers) {
+        // as advertisePhysics() did: unit looked up and strings built per metric
+        run(writer.first + ", per metric", [&](const std::string& asset) {
+            for (const auto& metric : metrics) {
+                const std::string& quantity = NutNames.name(metric.first);
+                std::string        type     = quantity.substr(0, quantity.find('.'));
+                auto               unit     = s_units.find(type);
+                std::string        units    = unit == s_units.end() ? "" : unit->second;
+                std::string        value(metric.second);
+                writer.second(asset, quantity, value, units, 60);
+            }
+        });
+
+        ShmBatch batch(s_units, writer.second);
+        run(writer.first + ", batch", [&](const std::string& asset) {
+            batch.begin(asset, 60);
+            for (const auto& metric : metrics) {
+                batch.add(metric.first, metric.second);
+            }
+            batch.commit();
+        });
+        CHECK(batch.stats().failures == 0);
+    }
+
+    fty_shm_delete_test_dir();
+}
@@ -0,0 +1,58 @@
+#include "src/alert_device.h"
+#include "src/nut_snapshot.h"
+#include <catch2/catch.hpp>
+
+TEST_CASE("nut snapshot test")
+{
+    using Vars = std::map<std::string, std::vector<std::string>>;
+
+    NutSnapshot::DevicesVars vars;
+    vars.emplace("ups-1",
+        std::make_shared<const NutVarTable>(Vars{{"ups.status", {"OL"}}, {"ambient.temperature.status", {"good"}}}));
+    vars.emplace("epdu-1", std::make_shared<const NutVarTable>(Vars{{"device.2.outlet.count", {"24"}}}));
+    auto snapshot = std::make_shared<const NutSnapshot>(std::move(vars), 1);
+
+    REQUIRE(snapshot->device("ups-1"));
+    CHECK(snapshot->device("ups-1")->size() == 2);
+    CHECK(snapshot->device("ups-2") == nullptr);
+    CHECK(snapshot->value("ups-1", "ups.status")[0] == "OL");
+    CHECK(snapshot->value("epdu-1", "device.2.outlet.count")[0] == "24");
+    CHECK_THROWS_AS(snapshot->value("ups-1", "ups.alarm"), std::runtime_error);
+    CHECK_THROWS_AS(snapshot->value("ups-2", "ups.status"), std::runtime_error);
+    CHECK(snapshot->generation() == 1);
+
+    NutSnapshotManager manager;
+    CHECK(manager.get() == nullptr);
+    manager.publish(snapshot);
+    CHECK(manager.get() == snapshot);
+
+    // readers keep their snapshot alive after a new one is published
+    auto reader = manager.get();
+    manager.publish(std::make_shared<const NutSnapshot>(NutSnapshot::DevicesVars(), 2));
+    CHECK(reader->generation() == 1);
+    CHECK(reader->device("ups-1"));
+    CHECK(manager.get()->generation() == 2);
+    CHECK(manager.get()->device("ups-1") == nullptr);
+
+    // a partial cycle shares the tables of the devices it did not read
+    NutSnapshot::DevicesVars partial;
+    partial.emplace("ups-1", std::make_shared<const NutVarTable>(Vars{{"ups.status", {"OB"}}}));
+    partial.emplace("epdu-1", snapshot->devices().at("epdu-1"));
+    NutSnapshot next(std::move(partial), 3);
+    CHECK(next.value("ups-1", "ups.status")[0] == "OB");
+    CHECK(next.device("epdu-1") == snapshot->device("epdu-1"));
+    CHECK(snapshot->value("ups-1", "ups.status")[0] == "OL");
+
+    // alert statuses are taken from the snapshot
+    Device                                          dev;
+    std::map<std::string, std::vector<std::string>> alerts = {
+        {"ambient.temperature.status", {"good"}},
+        {"ambient.temperature.high", {"40"}},
+        {"ambient.temperature.low", {"10"}},
+    };
+    dev.nutName("ups-1");
+    dev.addAlert("ambient.temperature", alerts);
+    REQUIRE(dev.alerts().size() == 1);
+    dev.update(*snapshot);
+    CHECK(dev.alerts()["ambient.temperature"].status == "good");
+}
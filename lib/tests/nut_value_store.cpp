@@ -0,0 +1,202 @@
+#include "src/nut_value_store.h"
+#include <catch2/catch.hpp>
+#include <cstring>
+#include <map>
+
+TEST_CASE("nut value store")
+{
+    NutValueStore store;
+    CHECK(store.empty());
+    CHECK_FALSE(store.changed());
+
+    const NameId load    = NutNames.id("load.default");
+    const NameId current = NutNames.id("current.input.L1");
+    const NameId model   = NutNames.id("model");
+
+    CHECK(store.set(load, "10"));
+    CHECK(store.set(model, "EPDU MI"));
+    CHECK(store.set(current, "1.5"));
+    CHECK(store.size() == 3);
+    CHECK(store.changed());
+    CHECK(store.changedCount() == 3);
+    CHECK(store.changed(load));
+
+    store.setChanged(false);
+    CHECK_FALSE(store.changed());
+    CHECK(store.changedCount() == 0);
+
+    // same value is not a change
+    CHECK_FALSE(store.set(load, "10"));
+    CHECK_FALSE(store.changed(load));
+    // shorter value is written in place, longer one appended
+    CHECK(store.set(load, "9"));
+    CHECK(store.set(current, "12.25"));
+    CHECK(store.changed(load));
+    CHECK(store.changed(current));
+    CHECK_FALSE(store.changed(model));
+    CHECK(store.changedCount() == 2);
+    store.setChanged(load, false);
+    store.setChanged(load, false);
+    CHECK(store.changedCount() == 1);
+    store.setChanged(load, true);
+    CHECK(store.get(load) == std::string_view("9"));
+    CHECK(store.get(current) == std::string_view("12.25"));
+    CHECK(store.get(model) == std::string_view("EPDU MI"));
+    CHECK_FALSE(store.get(NutNames.id("never.set")));
+    CHECK_FALSE(store.get(std::nullopt));
+
+    // values are NUL terminated
+    CHECK(strcmp(store.get(load)->data(), "9") == 0);
+
+    // iteration in name order, changed flags included
+    std::map<NameId, std::pair<std::string, bool>> items;
+    NameId                                         last = 0;
+    for (const auto& item : store) {
+        CHECK(item.name > last);
+        last = item.name;
+        items[item.name] = {std::string(item.value), item.changed};
+    }
+    CHECK(items.size() == 3);
+    CHECK(items[current] == std::make_pair(std::string("12.25"), true));
+    CHECK(items[model] == std::make_pair(std::string("EPDU MI"), false));
+
+    store.setChanged(model, true);
+    CHECK(store.changed(model));
+    store.clear();
+    CHECK(store.empty());
+    CHECK_FALSE(store.changed());
+}
+
+TEST_CASE("nut value store many values")
+{
+    NutValueStore       store;
+    std::vector<NameId> names;
+    for (int i = 0; i < 200; i++) {
+        names.push_back(NutNames.id("realpower.outlet." + std::to_string(i)));
+    }
+    // inserted in reverse order, the changed bits move with their values
+    for (size_t i = names.size(); i-- > 0;) {
+        store.set(names[i], std::to_string(i));
+        store.setChanged(names[i], i % 3 == 0);
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        CHECK(store.changed(names[i]) == (i % 3 == 0));
+    }
+    CHECK(store.changedCount() == 67);
+
+    // rewriting values compacts the arena, values stay right
+    for (int round = 0; round < 50; round++) {
+        for (size_t i = 0; i < names.size(); i++) {
+            store.set(names[i], std::to_string(i) + "." + std::string(size_t(round % 7), '5'));
+        }
+    }
+    for (size_t i = 0; i < names.size(); i++) {
+        CHECK(store.get(names[i]) == std::to_string(i) + "." + std::string(49 % 7, '5'));
+    }
+
+    store.setChanged(true);
+    size_t changed = 0;
+    for (const auto& item : store) {
+        changed += item.changed;
+    }
+    CHECK(changed == names.size());
+    CHECK(store.changedCount() == names.size());
+}
+
+TEST_CASE("nut physics store")
+{
+    NutPhysicsStore store;
+    auto            rules = DeadbandRules::parse("voltage.*=1,realpower.*=2%");
+
+    const NameId voltage   = NutNames.id("voltage.input.L1");
+    const NameId realpower = NutNames.id("realpower.default");
+    const NameId current   = NutNames.id("current.input.L1");
+    const NameId status    = NutNames.id("status.outlet.1");
+
+    CHECK(store.set(voltage, "230.0", rules));
+    CHECK(store.set(realpower, "1000", rules));
+    CHECK(store.set(current, "1.50", rules));
+    CHECK(store.set(status, "on", rules));
+    CHECK(store.changedCount() == 4);
+    // digits are kept as sent
+    CHECK(store.get(voltage) == std::string("230.0"));
+    CHECK(store.get(current) == std::string("1.50"));
+    CHECK(store.number(current)->mantissa == 150);
+    CHECK(store.get(status) == std::string("on"));
+    CHECK_FALSE(store.number(status));
+    store.setChanged(false);
+
+    // inside of the deadbands, old values are kept
+    CHECK_FALSE(store.set(voltage, "230.9", rules));
+    CHECK_FALSE(store.set(realpower, "1015", rules));
+    CHECK(store.get(voltage) == std::string("230.0"));
+    CHECK_FALSE(store.changed());
+
+    // no rule for current, any change counts
+    CHECK_FALSE(store.set(current, "1.5", rules));
+    CHECK(store.set(current, "1.51", rules));
+
+    // out of the deadbands
+    CHECK(store.set(voltage, "231.2", rules));
+    CHECK(store.set(realpower, "1025", rules));
+    CHECK(store.changedCount() == 3);
+
+    // text values are compared as text
+    CHECK_FALSE(store.set(status, "on", rules));
+    CHECK(store.set(status, "off", rules));
+    CHECK(store.set(voltage, "N/A", rules));
+    CHECK(store.set(voltage, "231.2", rules));
+
+    std::map<NameId, std::string> items;
+    for (const auto& item : store) {
+        items[item.name] = std::string(item.value);
+    }
+    CHECK(items[voltage] == "231.2");
+    CHECK(items[realpower] == "1025");
+    CHECK(items[status] == "off");
+
+    // new rules apply to stored names
+    store.setChanged(false);
+    store.deadbands(DeadbandRules());
+    CHECK(store.set(voltage, "231.3"));
+    CHECK(store.set(realpower, "1026"));
+
+    store.clear();
+    CHECK(store.empty());
+    CHECK_FALSE(store.changed());
+}
+
+TEST_CASE("nut physics store aggregates")
+{
+    NutPhysicsStore store;
+    auto            rules = DeadbandRules::parse("current.*=1");
+
+    const NameId current = NutNames.id("current.outlet.1");
+    const NameId status  = NutNames.id("status.outlet.1");
+
+    CHECK_FALSE(store.aggregate(current));
+    store.set(current, "2.0", rules);
+    store.set(current, "2.5", rules);
+    // a spike, inside of the deadband and then out of it
+    store.set(current, "2.75", rules);
+    store.set(current, "9", rules);
+    store.set(status, "on", rules);
+
+    // the deadband applies to the stored value, not to the samples
+    CHECK(store.get(current) == std::string("9"));
+    const auto* aggregate = store.aggregate(current);
+    REQUIRE(aggregate);
+    CHECK(aggregate->count == 4);
+    CHECK(aggregate->min.toString() == "2.0");
+    CHECK(aggregate->max.toString() == "9");
+    CHECK(aggregate->mean().toString() == "4.06");
+    // text values are not aggregated
+    CHECK_FALSE(store.aggregate(status));
+
+    store.resetAggregates();
+    CHECK_FALSE(store.aggregate(current));
+    store.set(current, "3", rules);
+    REQUIRE(store.aggregate(current));
+    CHECK(store.aggregate(current)->count == 1);
+    CHECK(store.aggregate(current)->mean().toString() == "3");
+}
@@ -0,0 +1,112 @@
+#include "src/nut_var_table.h"
+#include <algorithm>
+#include <catch2/catch.hpp>
+
+TEST_CASE("nut var table")
+{
+    NutVarTable table;
+    table.add("ups.status", "OL");
+    table.add("battery.charge", "90");
+    table.add("ups.load", "10");
+    table.add("battery.charge", "95"); // the last one wins
+    // lookups work while the table is being filled
+    CHECK(table.get("battery.charge") == std::string_view("95"));
+    table.seal();
+
+    CHECK(table.size() == 3);
+    CHECK(table.get("battery.charge") == std::string_view("95"));
+    CHECK(table.get("ups.load") == std::string_view("10"));
+    CHECK_FALSE(table.get("ups.realpower"));
+    CHECK_FALSE(table.has("ups"));
+
+    std::vector<std::string> names;
+    table.forEach([&names](std::string_view name, std::string_view) {
+        names.emplace_back(name);
+    });
+    // ordered by NameId, i.e. by the order of interning
+    std::sort(names.begin(), names.end());
+    CHECK(names == std::vector<std::string>{"battery.charge", "ups.load", "ups.status"});
+
+    // a value copied from the table itself
+    table.set("ups.load", "20");
+    table.set("ups.realpower", *table.get("ups.load"));
+    CHECK(table.get("ups.load") == std::string_view("20"));
+    CHECK(table.get("ups.realpower") == std::string_view("20"));
+    CHECK(table.size() == 4);
+
+    // lookups by id and by prefix + name
+    CHECK(table.get(NutNames.id("ups.load")) == std::string_view("20"));
+    CHECK(table.get("ups.", "load") == std::string_view("20"));
+    table.set("ups.", "temperature", "25");
+    CHECK(table.get("ups.temperature") == std::string_view("25"));
+    CHECK_FALSE(table.has("ups.", "never.interned.variable"));
+}
+
+TEST_CASE("nut var table layer")
+{
+    NutVarTable base(std::map<std::string, std::vector<std::string>>{
+        {"device.type", {"pdu"}},
+        {"outlet.1.realpower", {"10"}},
+        {"ups.mfr", {"Eaton", "Corp"}},
+    });
+    CHECK(base.get("ups.mfr") == std::string_view("Eaton, Corp"));
+
+    NutVarTable layer(&base);
+    CHECK_FALSE(layer.empty());
+    CHECK(layer.size() == 0);
+    CHECK(layer.get("outlet.1.realpower") == std::string_view("10"));
+
+    layer.set("device.type", "epdu");
+    layer.set("ups.realpower", "10");
+    layer.set("a.first", "1");
+    CHECK(layer.get("device.type") == std::string_view("epdu"));
+    CHECK(base.get("device.type") == std::string_view("pdu"));
+    CHECK_FALSE(base.has("ups.realpower"));
+
+    std::vector<std::pair<std::string, std::string>> all;
+    layer.forEach([&all](std::string_view name, std::string_view value) {
+        all.emplace_back(name, value);
+    });
+    std::sort(all.begin(), all.end());
+    CHECK(all == std::vector<std::pair<std::string, std::string>>{
+                     {"a.first", "1"},
+                     {"device.type", "epdu"},
+                     {"outlet.1.realpower", "10"},
+                     {"ups.mfr", "Eaton, Corp"},
+                     {"ups.realpower", "10"},
+                 });
+
+    CHECK_THROWS_AS(NutVarTable(&layer), std::invalid_argument);
+}
+
+TEST_CASE("nut var table schema")
+{
+    NutVarTable sorted;
+    sorted.add("ups.load", "10");
+    sorted.add("ups.status", "OL");
+    sorted.seal();
+
+    NutVarTable unsorted;
+    unsorted.add("ups.status", "OB");
+    unsorted.add("ups.load", "20");
+    unsorted.add("ups.status", "OL");
+    unsorted.seal();
+
+    // values don't matter, order and duplicates neither
+    CHECK(sorted.schema() == unsorted.schema());
+    CHECK(sorted.schema() != NutVarTable().schema());
+
+    NutVarTable layer(&sorted);
+    CHECK(layer.schema() == sorted.schema());
+    layer.set("ups.load", "11");
+    CHECK(layer.schema() == sorted.schema());
+    layer.set("ups.realpower", "100");
+    CHECK(layer.schema() != sorted.schema());
+
+    NutVarTable all;
+    all.add("ups.load", "10");
+    all.add("ups.realpower", "100");
+    all.add("ups.status", "OL");
+    all.seal();
+    CHECK(layer.schema() == all.schema());
+}
@@ -0,0 +1,99 @@
+#include "src/persistent_map.h"
+#include <catch2/catch.hpp>
+#include <map>
+#include <random>
+#include <string>
+
+// same items in the same order
+template <typename Map>
+static bool s_same(const Map& map, const std::map<int, int>& reference)
+{
+    if (map.size() != reference.size() || map.empty() != reference.empty()) {
+        return false;
+    }
+    auto it = map.begin();
+    for (const auto& item : reference) {
+        if (it == map.end() || it->first != item.first || it->second != item.second) {
+            return false;
+        }
+        ++it;
+    }
+    return it == map.end();
+}
+
+TEST_CASE("persistent map")
+{
+    PersistentMap<int, int> map;
+    CHECK(map.empty());
+    CHECK(map.begin() == map.end());
+    CHECK(map.find(1) == map.end());
+    CHECK_THROWS_AS(map.at(1), std::out_of_range);
+
+    map.insert_or_assign(2, 20);
+    map.insert_or_assign(1, 10);
+    map.insert_or_assign(3, 30);
+    CHECK(map.size() == 3);
+    CHECK(map.at(2) == 20);
+    CHECK(map.count(3) == 1);
+    CHECK(map.count(4) == 0);
+    CHECK(map.lower_bound(0)->first == 1);
+    CHECK(map.lower_bound(2)->first == 2);
+    CHECK(map.lower_bound(4) == map.end());
+
+    // copies keep their version
+    auto copy = map;
+    map.insert_or_assign(2, 21);
+    CHECK(map.erase(1) == 1);
+    CHECK(map.erase(1) == 0);
+    CHECK(map.size() == 2);
+    CHECK(map.at(2) == 21);
+    CHECK(copy.size() == 3);
+    CHECK(copy.at(1) == 10);
+    CHECK(copy.at(2) == 20);
+
+    auto it = copy.find(2);
+    REQUIRE(it != copy.end());
+    CHECK((++it)->first == 3);
+    CHECK(++it == copy.end());
+
+    copy.clear();
+    CHECK(copy.empty());
+    CHECK(map.size() == 2);
+}
+
+TEST_CASE("persistent map same as std::map")
+{
+    std::mt19937                         random(42);
+    PersistentMap<int, int>              map;
+    std::map<int, int>                   reference;
+    std::vector<PersistentMap<int, int>> versions;
+    std::vector<std::map<int, int>>      references;
+
+    for (int i = 0; i < 20000; i++) {
+        int key = int(random() % 1000);
+        if (random() % 3) {
+            map.insert_or_assign(key, i);
+            reference[key] = i;
+        } else {
+            REQUIRE(map.erase(key) == reference.erase(key));
+        }
+        if (i % 1000 == 0) {
+            versions.push_back(map);
+            references.push_back(reference);
+        }
+        REQUIRE(map.size() == reference.size());
+    }
+    CHECK(s_same(map, reference));
+    for (size_t i = 0; i < versions.size(); i++) {
+        CHECK(s_same(versions[i], references[i]));
+    }
+    for (int key = 0; key < 1000; key++) {
+        auto it = reference.lower_bound(key);
+        auto at = map.lower_bound(key);
+        REQUIRE((it == reference.end()) == (at == map.end()));
+        if (at != map.end()) {
+            CHECK(at->first == it->first);
+        }
+        CHECK(map.count(key) == reference.count(key));
+    }
+}
@@ -1,3 +1,4 @@
+#include "src/nut_inventory.h"
 #include "src/sensor_list.h"
 #include "src/state_manager.h"
 #include <catch2/catch.hpp>
@@ -77,6 +78,8 @@ TEST_CASE("sensor actor test")
 
     sensors.sensors()["sensor1"].setInventory(
         {{"ambient.model", "Model 1"}, {"ambient.serial", "1111"}, {"ambient.name", "Ambient 1"}});
+    // the digest of the inventory is kept once it has been sent
+    NutDigests.erase("sensor-1");
     sensors.advertiseInventory(producer);
     msg = mlm_client_recv(consumer);
     REQUIRE(msg);
@@ -88,6 +91,7 @@ TEST_CASE("sensor actor test")
     CHECK(streq(fty_proto_ext_string(bmsg, "ambient.serial", ""), "1111"));
     CHECK(streq(fty_proto_ext_string(bmsg, "ambient.name", ""), "Ambient 1"));
     fty_proto_destroy(&bmsg);
+    CHECK(NutDigests.get("sensor-1"));
 
     // gpio on EMP001
     std::vector<std::string> contacts;
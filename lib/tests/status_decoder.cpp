@@ -0,0 +1,176 @@
+#include "src/status_decoder.h"
+#include "src/ups_status.h"
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+// Decoding as NUTAgent and upsstatus_to_int() did it before, the reference
+// of the tests and of the benchmark.
+static uint16_t s_legacyToken(const char* status)
+{
+    static const struct
+    {
+        const char* str;
+        int         value;
+    } info[] = {{"CAL", STATUS_CAL}, {"TRIM", STATUS_TRIM}, {"BOOST", STATUS_BOOST}, {"OL", STATUS_OL},
+        {"OB", STATUS_OB}, {"OVER", STATUS_OVER}, {"LB", STATUS_LB}, {"RB", STATUS_RB}, {"BYPASS", STATUS_BYPASS},
+        {"OFF", STATUS_OFF}, {"CHRG", STATUS_CHRG}, {"DISCHRG", STATUS_DISCHRG}, {"HB", STATUS_HB},
+        {"FSD", STATUS_FSD}, {"ALARM", STATUS_ALARM}, {"NULL", 0}};
+    for (int i = 0; info[i].value; i++) {
+        if (strncasecmp(info[i].str, status, strlen(info[i].str)) == 0) {
+            return uint16_t(info[i].value);
+        }
+    }
+    return 0;
+}
+
+static uint16_t s_legacyStatus(const char* status, const char* test_result)
+{
+    int   result = 0;
+    char* buff   = strdup(status);
+    char* b      = buff;
+    while (b) {
+        char* e = strchr(b, ' ');
+        if (e) {
+            *e = 0;
+            e++;
+        }
+        result |= s_legacyToken(b);
+        b = e;
+    }
+    free(buff);
+    if (strcmp(test_result, "in progress") == 0) {
+        result |= STATUS_CAL;
+    }
+    if (!(result & (STATUS_OL | STATUS_OB))) {
+        if ((result & STATUS_CHRG) && !(result & STATUS_DISCHRG)) {
+            result |= STATUS_OL;
+        } else if (!(result & STATUS_CHRG) && (result & STATUS_DISCHRG)) {
+            result |= STATUS_OB;
+        }
+    }
+    return uint16_t(result);
+}
+
+static UpsAlarms s_legacyAlarms(const std::string& alarms)
+{
+    UpsAlarms result;
+    for (size_t bit = 0; bit < UPS_ALARMS.size(); bit++) {
+        if (alarms.find(UPS_ALARMS[bit]) != std::string::npos) {
+            result.bits |= uint16_t(1 << bit);
+            result.listed = true;
+        }
+    }
+    if (alarms.find("Internal failure!") != std::string::npos) {
+        result.bits |= uint16_t(1 << 8);
+    }
+    return result;
+}
+
+TEST_CASE("status decoder tokens")
+{
+    CHECK(decodeUpsStatusToken("OL") == STATUS_OL);
+    CHECK(decodeUpsStatusToken("ol") == STATUS_OL);
+    CHECK(decodeUpsStatusToken("DisChrg") == STATUS_DISCHRG);
+    CHECK(decodeUpsStatusToken("ALARM") == STATUS_ALARM);
+    // prefix of a known token is enough, as with strncasecmp
+    CHECK(decodeUpsStatusToken("OLX") == STATUS_OL);
+    CHECK(decodeUpsStatusToken("BOOSTING") == STATUS_BOOST);
+    CHECK(decodeUpsStatusToken("O") == 0);
+    CHECK(decodeUpsStatusToken("") == 0);
+    CHECK(decodeUpsStatusToken("NULL") == 0);
+
+    CHECK(decodeUpsStatus("OL CHRG", "") == (STATUS_OL | STATUS_CHRG));
+    CHECK(decodeUpsStatus("OL", "in progress") == (STATUS_OL | STATUS_CAL));
+    CHECK(decodeUpsStatus("CHRG", "") == (STATUS_OL | STATUS_CHRG));
+    CHECK(decodeUpsStatus("OB  LB ", "") == (STATUS_OB | STATUS_LB));
+}
+
+TEST_CASE("status decoder same as legacy")
+{
+    const char* tokens[] = {"CAL", "TRIM", "BOOST", "OL", "OB", "OVER", "LB", "RB", "BYPASS", "OFF", "CHRG",
+        "DISCHRG", "HB", "FSD", "ALARM", "ol", "Ob", "OLX", "OFFLINE", "X", "", "NULL", "CALIBRATING", "BYPASSED"};
+    std::mt19937 random(42);
+    for (int i = 0; i < 10000; i++) {
+        std::string status;
+        size_t      count = random() % 5;
+        for (size_t j = 0; j < count; j++) {
+            status += (j ? " " : "") + std::string(tokens[random() % (sizeof(tokens) / sizeof(tokens[0]))]);
+        }
+        const char* test = random() % 4 ? "no test initiated" : "in progress";
+        INFO(status << " / " << test);
+        REQUIRE(decodeUpsStatus(status, test) == s_legacyStatus(status.c_str(), test));
+        REQUIRE(upsstatus_to_int(status, test) == s_legacyStatus(status.c_str(), test));
+    }
+}
+
+TEST_CASE("pattern matcher")
+{
+    PatternMatcher matcher({"he", "she", "his", "hers", "x"});
+    CHECK(matcher.match("") == 0);
+    CHECK(matcher.match("ushers") == 0b1011);
+    CHECK(matcher.match("this") == 0b0100);
+    CHECK(matcher.match("hhhe") == 0b0001);
+    CHECK(matcher.match("h") == 0);
+    CHECK(matcher.match(std::string_view("\xff\0x", 3)) == 0b10000);
+
+    PatternMatcher empty({});
+    CHECK(empty.match("anything") == 0);
+}
+
+TEST_CASE("status decoder alarms")
+{
+    auto check = [](const std::string& alarms) {
+        UpsAlarms decoded = decodeUpsAlarms(alarms);
+        UpsAlarms legacy  = s_legacyAlarms(alarms);
+        INFO(alarms);
+        CHECK(decoded.bits == legacy.bits);
+        CHECK(decoded.listed == legacy.listed);
+    };
+    check("");
+    check("Replace battery!");
+    check("Fan failure! Fuse fault!");
+    check("Replace battery!Shutdown imminent!Battery voltage too high!");
+    check("Internal failure!");
+    check("Internal failure! Internal UPS fault!");
+    check("Battery voltage too lo");
+    check("Manual bypass mode! Automatic bypass mode! Communication fault!");
+
+    CHECK(decodeUpsAlarms("Fan failure! Fuse fault!").bits == ((1 << 2) | (1 << 13)));
+    CHECK(decodeUpsAlarms("Internal failure!").bits == (1 << 8));
+    CHECK_FALSE(decodeUpsAlarms("Internal failure!").listed);
+}
+
+// Not run by default, select it with the "[benchmark]" tag
+TEST_CASE("status decoder benchmark", "[.][benchmark]")
+{
+    const int   rounds = 1000000;
+    const char* status = "OL CHRG BYPASS ALARM";
+    std::string alarms = "Replace battery! Fan failure! Internal failure!";
+
+    auto run = [&](const char* name, auto&& decode) {
+        uint32_t sink  = 0;
+        auto     start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            sink += decode();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        printf("%s: %.0f ns per call (%u)\n", name, seconds * 1e9 / rounds, sink);
+    };
+
+    run("status, legacy", [&] {
+        return s_legacyStatus(status, "no test initiated");
+    });
+    run("status, decoder", [&] {
+        return decodeUpsStatus(status, "no test initiated");
+    });
+    run("alarms, legacy", [&] {
+        return s_legacyAlarms(alarms).bits;
+    });
+    run("alarms, decoder", [&] {
+        return decodeUpsAlarms(alarms).bits;
+    });
+}